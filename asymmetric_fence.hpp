@@ -0,0 +1,63 @@
+#ifndef _ASYMMETRIC_FENCE_
+#define _ASYMMETRIC_FENCE_
+
+#include <atomic>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__NR_membarrier)
+#include <linux/membarrier.h>
+#define ASYMMETRIC_FENCE_MEMBARRIER
+#endif
+#endif
+
+namespace reclamation { namespace techniques { namespace utils {
+
+// Splits a seq_cst fence into a cheap half for the frequent side and an expensive half for the rare side.
+// If the process could register for expedited private membarriers, light() is only a compiler barrier and
+// heavy() forces a full memory barrier on every running thread of the process. Otherwise both halves fall
+// back to a regular seq_cst fence.
+struct asymmetric_fence {
+    static void light() {
+        if (is_available())
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        else
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    static void heavy() {
+#ifdef ASYMMETRIC_FENCE_MEMBARRIER
+        if (is_available())
+        {
+            syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+            return;
+        }
+#endif
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    // The process registers on first use, so programs that never use the fence make no syscall.
+    // The initialization of the local static happens-before every later read of it, so all threads
+    // agree on which pairing is in use.
+    static bool is_available() {
+        static const bool available = register_process();
+        return available;
+    }
+
+private:
+    static bool register_process() {
+#ifdef ASYMMETRIC_FENCE_MEMBARRIER
+        auto supported = syscall(__NR_membarrier, MEMBARRIER_CMD_QUERY, 0);
+        if (supported < 0 || (supported & MEMBARRIER_CMD_PRIVATE_EXPEDITED) == 0)
+            return false;
+        return syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0) == 0;
+#else
+        return false;
+#endif
+    }
+};
+
+}}}
+
+#endif
@@ -0,0 +1,650 @@
+#include "epoch_based.hpp"
+#include "harris_michael_list_based_set.hpp"
+#include "michael_scott_queue.hpp"
+#include "quiescent_state_based.hpp"
+#include "skip_list_map.hpp"
+#include "split_ordered_hash_map.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// usage: bench [options]
+//   --workload NAME|all   operation mix (default all): read, advance, read-mostly, mixed,
+//                         write-heavy, queue, list, hash-map, hash-map-update, locked-map,
+//                         locked-map-update, skip-list, skip-list-scan
+//   --threads 1,2,4       comma separated thread counts (default 1,2,4,8)
+//   --duration MS         duration of each run in milliseconds (default 1000)
+//   --threshold N         UpdateThreshold, one of 0,1,10,100,1000 (default 100; advance always uses 0)
+//   --reclaimer NAME      epoch (epoch_based, default) or qsbr (quiescent_state_based)
+//   --advance-step N      epoch only: threads checked per critical region entry (default 0, full scans)
+//   --format csv|json     output format (default csv)
+//
+// The read and advance workloads measure critical region entry: every worker acquires a guard_ptr
+// on one shared node, reads it and resets the guard, while an extra writer thread replaces the node
+// every 100us so that epochs actually advance. advance runs with UpdateThreshold 0, so nearly every
+// entry scans all thread control blocks. The mode column tells how epoch_based enters critical
+// regions: seq_cst, asymmetric (membarrier) or asymmetric-fallback (membarrier is unavailable).
+// The table workloads pick a random slot out of a shared array of concurrent_ptrs. Reads acquire
+// a guard_ptr, touch the node and reset the guard; writes replace the node and reclaim the old one.
+// The queue, list, hash-map and skip-list workloads run the michael_scott_queue,
+// harris_michael_list_based_set, split_ordered_hash_map and skip_list_map.
+// One out of sample_interval operations is timed; a monitor thread polls the number of retired
+// but not yet reclaimed objects (reported as n/a for qsbr, which does not count them).
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+// Log-linear latency histogram: 8 linear sub-buckets per power of two.
+struct histogram {
+    static constexpr unsigned sub_buckets = 8;
+    static constexpr unsigned buckets = 64 * sub_buckets;
+
+    void record(std::uint64_t ns) {
+        ++counts[index(ns)];
+        ++total;
+        max = std::max(max, ns);
+    }
+
+    void merge(const histogram& other) {
+        for (unsigned i = 0; i < buckets; ++i)
+            counts[i] += other.counts[i];
+        total += other.total;
+        max = std::max(max, other.max);
+    }
+
+    // Upper bound of the bucket containing the given percentile.
+    std::uint64_t percentile(double p) const {
+        if (total == 0)
+            return 0;
+        auto rank = static_cast<std::uint64_t>(p / 100.0 * (total - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (unsigned i = 0; i < buckets; ++i)
+        {
+            seen += counts[i];
+            if (seen >= rank)
+                return std::min(upper_bound(i), max);
+        }
+        return max;
+    }
+
+    std::array<std::uint64_t, buckets> counts = {};
+    std::uint64_t total = 0;
+    std::uint64_t max = 0;
+
+private:
+    static unsigned index(std::uint64_t v) {
+        if (v < sub_buckets)
+            return static_cast<unsigned>(v);
+        unsigned log = 63 - __builtin_clzll(v);
+        unsigned shift = log - 3; // log2(sub_buckets)
+        return (shift + 1) * sub_buckets + static_cast<unsigned>((v >> shift) & (sub_buckets - 1));
+    }
+
+    static std::uint64_t upper_bound(unsigned i) {
+        if (i < sub_buckets)
+            return i;
+        unsigned shift = i / sub_buckets - 1;
+        std::uint64_t base = (std::uint64_t(sub_buckets) + i % sub_buckets) << shift;
+        return base + (std::uint64_t(1) << shift) - 1;
+    }
+};
+
+enum class structure { root, table, queue, list, hash_map, locked_map, skip_list, skip_list_scan };
+
+// For the queue, reads are try_pop and writes are push; for the list and the maps, reads are
+// lookups and writes alternate between insert and erase. locked-map is the baseline for
+// hash-map: a std::unordered_map per shard, each protected by a std::mutex. The skip list holds
+// a million entries; skip-list-scan reads are range scans over 100 consecutive keys.
+// Workloads with a fixed threshold ignore --threshold.
+constexpr std::size_t any_threshold = ~std::size_t(0);
+
+struct workload {
+    const char* name;
+    structure kind;
+    unsigned read_percent;
+    std::size_t threshold = any_threshold;
+};
+
+constexpr workload workloads[] = {
+    {"read", structure::root, 100},
+    {"advance", structure::root, 100, 0},
+    {"read-mostly", structure::table, 90},
+    {"mixed", structure::table, 50},
+    {"write-heavy", structure::table, 10},
+    {"queue", structure::queue, 50},
+    {"list", structure::list, 80},
+    {"hash-map", structure::hash_map, 90},
+    {"hash-map-update", structure::hash_map, 10},
+    {"locked-map", structure::locked_map, 90},
+    {"locked-map-update", structure::locked_map, 10},
+    {"skip-list", structure::skip_list, 90},
+    {"skip-list-scan", structure::skip_list_scan, 90},
+};
+
+class sharded_map {
+public:
+    bool insert(std::uint64_t key, std::uint64_t value) {
+        auto& s = shard(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.map.emplace(key, value).second;
+    }
+
+    bool erase(std::uint64_t key) {
+        auto& s = shard(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.map.erase(key) != 0;
+    }
+
+    bool find(std::uint64_t key, std::uint64_t& value) {
+        auto& s = shard(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = s.map.find(key);
+        if (it == s.map.end())
+            return false;
+        value = it->second;
+        return true;
+    }
+
+private:
+    static constexpr std::size_t shards = 64;
+
+    struct alignas(64) shard_type {
+        std::mutex mutex;
+        std::unordered_map<std::uint64_t, std::uint64_t> map;
+    };
+
+    shard_type& shard(std::uint64_t key) { return shard_array[(key * 0x9E3779B97F4A7C15ull) >> 58]; }
+
+    shard_type shard_array[shards];
+};
+
+struct result {
+    std::string workload;
+    unsigned threads;
+    std::string reclaimer;
+    std::string mode;
+    std::size_t threshold;
+    double seconds;
+    std::uint64_t ops;
+    std::uint64_t reads;
+    std::uint64_t writes;
+    histogram read_latency;
+    histogram write_latency;
+    histogram reclaim_latency;
+    std::optional<std::size_t> peak_unreclaimed;
+};
+
+// With QSBR, workers pass through a quiescent state after every operation. Its unreclaimed
+// objects are not counted, so there is no peak_unreclaimed.
+template <class Reclaimer>
+struct reclaimer_traits {
+    static constexpr const char* name = "epoch";
+#ifdef EPOCH_BASED_ASYMMETRIC_FENCE
+    static const char* mode() {
+        return reclamation::techniques::utils::asymmetric_fence::is_available() ? "asymmetric" : "asymmetric-fallback";
+    }
+#else
+    static const char* mode() { return "seq_cst"; }
+#endif
+    static constexpr bool counts_pending = true;
+    static void quiescent_state() {}
+    static std::size_t pending_objects() { return Reclaimer::pending_retired().first; }
+};
+
+template <std::size_t UpdateThreshold>
+struct reclaimer_traits<reclamation::techniques::quiescent_state_based<UpdateThreshold>> {
+    static constexpr const char* name = "qsbr";
+    static const char* mode() { return "n/a"; }
+    static constexpr bool counts_pending = false;
+    static void quiescent_state() { reclamation::techniques::quiescent_state_based<UpdateThreshold>::quiescent_state(); }
+    static std::size_t pending_objects() { return 0; }
+};
+
+template <class Reclaimer, std::size_t UpdateThreshold>
+struct benchmark
+{
+    using reclaimer = Reclaimer;
+    using traits = reclaimer_traits<Reclaimer>;
+
+    struct node : reclaimer::template enable_concurrent_ptr<node>
+    {
+        explicit node(std::uint64_t value) : value(value) {}
+        std::uint64_t value;
+    };
+
+    using concurrent_ptr = typename reclaimer::template concurrent_ptr<node>;
+
+    static constexpr std::size_t slots = 1024;
+    static constexpr std::size_t list_keys = 256;
+    static constexpr std::size_t map_keys = 1 << 16;
+    static constexpr std::size_t skip_list_keys = 1 << 21;
+    static constexpr std::size_t scan_length = 100;
+    static constexpr unsigned sample_interval = 16;
+
+    struct thread_result {
+        std::uint64_t reads = 0;
+        std::uint64_t writes = 0;
+        histogram read_latency;
+        histogram write_latency;
+        histogram reclaim_latency;
+    };
+
+    static result run(const workload& w, unsigned threads, unsigned duration_ms)
+    {
+        concurrent_ptr root;
+        std::vector<concurrent_ptr> table(slots);
+
+        reclamation::michael_scott_queue<std::uint64_t, reclaimer> queue;
+        reclamation::harris_michael_list_based_set<std::uint64_t, reclaimer> list;
+        reclamation::split_ordered_hash_map<std::uint64_t, std::uint64_t, reclaimer> hash_map;
+        sharded_map locked_map;
+        reclamation::skip_list_map<std::uint64_t, std::uint64_t, reclaimer> skip_list;
+        // Setup and teardown run on helper threads, so that the main thread never registers with
+        // the reclaimer; a registered QSBR thread that never passes a quiescent state would block
+        // all reclamation.
+        std::thread([&]() {
+            root.store(typename concurrent_ptr::marked_ptr(new node(0)));
+            for (auto& p : table)
+                p.store(typename concurrent_ptr::marked_ptr(new node(0)));
+            for (std::uint64_t key = 0; key < map_keys; key += 2)
+            {
+                if (w.kind == structure::hash_map)
+                    hash_map.insert(key, key);
+                else if (w.kind == structure::locked_map)
+                    locked_map.insert(key, key);
+            }
+            if (w.kind == structure::skip_list || w.kind == structure::skip_list_scan)
+                for (std::uint64_t key = 0; key < skip_list_keys; key += 2)
+                    skip_list.insert(key, key);
+        }).join();
+
+        std::atomic<bool> start(false);
+        std::atomic<bool> stop(false);
+        std::vector<thread_result> results(threads);
+
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < threads; ++i)
+            workers.emplace_back([&, i]() {
+                auto& r = results[i];
+                std::minstd_rand rng(i + 1);
+                std::uint64_t sum = 0;
+                typename concurrent_ptr::guard_ptr guard;
+                // QSBR threads have to be registered before they acquire guards
+                traits::quiescent_state();
+                while (!start.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+
+                for (std::uint64_t n = 0; !stop.load(std::memory_order_relaxed); ++n)
+                {
+                    const bool read = rng() % 100 < w.read_percent;
+                    const bool sample = n % sample_interval == 0;
+                    const auto t0 = sample ? clock_type::now() : clock_type::time_point();
+                    if (w.kind == structure::root)
+                    {
+                        guard.acquire(root, std::memory_order_acquire);
+                        sum += guard->value;
+                        guard.reset();
+                    }
+                    else if (w.kind == structure::queue)
+                    {
+                        std::uint64_t value;
+                        if (read)
+                            sum += queue.try_pop(value) ? value : 0;
+                        else
+                            queue.push(n);
+                    }
+                    else if (w.kind == structure::list)
+                    {
+                        const auto key = rng() % list_keys;
+                        if (read)
+                            sum += list.contains(key);
+                        else if (n & 1)
+                            list.insert(key);
+                        else
+                            list.erase(key);
+                    }
+                    else if (w.kind == structure::hash_map)
+                    {
+                        const auto key = rng() % map_keys;
+                        std::uint64_t value = 0;
+                        if (read)
+                            sum += hash_map.find(key, value) ? value : 0;
+                        else if (n & 1)
+                            hash_map.insert(key, n);
+                        else
+                            hash_map.erase(key);
+                    }
+                    else if (w.kind == structure::locked_map)
+                    {
+                        const auto key = rng() % map_keys;
+                        std::uint64_t value = 0;
+                        if (read)
+                            sum += locked_map.find(key, value) ? value : 0;
+                        else if (n & 1)
+                            locked_map.insert(key, n);
+                        else
+                            locked_map.erase(key);
+                    }
+                    else if (w.kind == structure::skip_list || w.kind == structure::skip_list_scan)
+                    {
+                        const auto key = rng() % skip_list_keys;
+                        std::uint64_t value = 0;
+                        if (read && w.kind == structure::skip_list_scan)
+                        {
+                            for (auto& entry : skip_list.scan(key, key + scan_length))
+                                sum += entry.second;
+                        }
+                        else if (read)
+                            sum += skip_list.find(key, value) ? value : 0;
+                        else if (n & 1)
+                            skip_list.insert(key, n);
+                        else
+                            skip_list.erase(key);
+                    }
+                    else if (read)
+                    {
+                        guard.acquire(table[rng() % slots], std::memory_order_acquire);
+                        if (guard)
+                            sum += guard->value;
+                        guard.reset();
+                    }
+                    else
+                    {
+                        auto& slot = table[rng() % slots];
+                        auto replacement = new node(n);
+                        for (;;)
+                        {
+                            guard.acquire(slot, std::memory_order_acquire);
+                            auto expected = typename concurrent_ptr::marked_ptr(guard.get());
+                            if (slot.compare_exchange_weak(expected, typename concurrent_ptr::marked_ptr(replacement),
+                                    std::memory_order_release, std::memory_order_relaxed))
+                                break;
+                        }
+                        const auto t1 = sample ? clock_type::now() : clock_type::time_point();
+                        guard.reclaim();
+                        if (sample)
+                            r.reclaim_latency.record(elapsed(t1));
+                    }
+
+                    traits::quiescent_state();
+
+                    if (read)
+                        ++r.reads;
+                    else
+                        ++r.writes;
+                    if (sample)
+                        (read ? r.read_latency : r.write_latency).record(elapsed(t0));
+                }
+                // keep the reads from being optimized away
+                if (sum == 42)
+                    std::cerr << "";
+            });
+
+        std::thread writer;
+        if (w.kind == structure::root)
+            writer = std::thread([&]() {
+                traits::quiescent_state();
+                while (!start.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+                for (std::uint64_t value = 1; !stop.load(std::memory_order_relaxed); ++value)
+                {
+                    {
+                        auto guard = reclamation::acquire_guard(root);
+                        root.store(typename concurrent_ptr::marked_ptr(new node(value)));
+                        guard.reclaim();
+                    }
+                    traits::quiescent_state();
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                }
+            });
+
+        std::size_t peak = 0;
+        std::thread monitor([&]() {
+            while (traits::counts_pending && !stop.load(std::memory_order_relaxed))
+            {
+                peak = std::max(peak, traits::pending_objects());
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+
+        const auto begin = clock_type::now();
+        start.store(true, std::memory_order_release);
+        std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+        stop.store(true);
+        for (auto& t : workers)
+            t.join();
+        const auto end = clock_type::now();
+        if (writer.joinable())
+            writer.join();
+        monitor.join();
+
+        std::thread([&]() {
+            traits::quiescent_state();
+            {
+                auto guard = reclamation::acquire_guard(root);
+                root.store(nullptr);
+                guard.reclaim();
+            }
+            for (auto& p : table)
+            {
+                auto guard = reclamation::acquire_guard(p);
+                p.store(nullptr);
+                guard.reclaim();
+            }
+        }).join();
+
+        result res{w.name, threads, traits::name, traits::mode(), UpdateThreshold, std::chrono::duration<double>(end - begin).count(),
+                   0, 0, 0, {}, {}, {}, std::nullopt};
+        if (traits::counts_pending)
+            res.peak_unreclaimed = peak;
+        for (auto& r : results)
+        {
+            res.reads += r.reads;
+            res.writes += r.writes;
+            res.read_latency.merge(r.read_latency);
+            res.write_latency.merge(r.write_latency);
+            res.reclaim_latency.merge(r.reclaim_latency);
+        }
+        res.ops = res.reads + res.writes;
+        return res;
+    }
+
+    static std::uint64_t elapsed(clock_type::time_point since) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - since).count();
+    }
+};
+
+template <template <std::size_t> class Reclaimer>
+result run(const workload& w, unsigned threads, unsigned duration_ms, std::size_t threshold)
+{
+    switch (threshold)
+    {
+        case 0: return benchmark<Reclaimer<0>, 0>::run(w, threads, duration_ms);
+        case 1: return benchmark<Reclaimer<1>, 1>::run(w, threads, duration_ms);
+        case 10: return benchmark<Reclaimer<10>, 10>::run(w, threads, duration_ms);
+        case 100: return benchmark<Reclaimer<100>, 100>::run(w, threads, duration_ms);
+        case 1000: return benchmark<Reclaimer<1000>, 1000>::run(w, threads, duration_ms);
+    }
+    std::cerr << "unsupported threshold " << threshold << '\n';
+    std::exit(1);
+}
+
+result run(const workload& w, unsigned threads, unsigned duration_ms, std::size_t threshold, const std::string& reclaimer)
+{
+    if (reclaimer == "qsbr")
+        return run<reclamation::techniques::quiescent_state_based>(w, threads, duration_ms, threshold);
+    return run<reclamation::techniques::epoch_based>(w, threads, duration_ms, threshold);
+}
+
+void set_advance_step(std::size_t step)
+{
+    using reclamation::techniques::epoch_based;
+    epoch_based<0>::set_epoch_advance_step(step);
+    epoch_based<1>::set_epoch_advance_step(step);
+    epoch_based<10>::set_epoch_advance_step(step);
+    epoch_based<100>::set_epoch_advance_step(step);
+    epoch_based<1000>::set_epoch_advance_step(step);
+}
+
+const double percentiles[] = {50, 90, 99, 99.9};
+const char* const percentile_names[] = {"p50", "p90", "p99", "p999"};
+
+void print_csv_header()
+{
+    std::cout << "workload,threads,reclaimer,mode,threshold,seconds,ops,ops_per_sec,reads,writes,peak_unreclaimed";
+    for (auto op : {"read", "write", "reclaim"})
+    {
+        for (auto name : percentile_names)
+            std::cout << ',' << op << '_' << name << "_ns";
+        std::cout << ',' << op << "_max_ns";
+    }
+    std::cout << '\n';
+}
+
+void print_csv(const result& r)
+{
+    std::cout << r.workload << ',' << r.threads << ',' << r.reclaimer << ',' << r.mode << ',' << r.threshold << ',' << r.seconds << ','
+              << r.ops << ',' << static_cast<std::uint64_t>(r.ops / r.seconds) << ','
+              << r.reads << ',' << r.writes << ',';
+    if (r.peak_unreclaimed)
+        std::cout << *r.peak_unreclaimed;
+    else
+        std::cout << "n/a";
+    for (auto h : {&r.read_latency, &r.write_latency, &r.reclaim_latency})
+    {
+        for (auto p : percentiles)
+            std::cout << ',' << h->percentile(p);
+        std::cout << ',' << h->max;
+    }
+    std::cout << '\n';
+}
+
+void print_json_histogram(const char* name, const histogram& h)
+{
+    std::cout << "\"" << name << "\": {";
+    for (unsigned i = 0; i < 4; ++i)
+        std::cout << "\"" << percentile_names[i] << "_ns\": " << h.percentile(percentiles[i]) << ", ";
+    std::cout << "\"max_ns\": " << h.max << ", \"samples\": " << h.total << "}";
+}
+
+void print_json(const result& r, bool first)
+{
+    std::cout << (first ? "  " : ",\n  ")
+              << "{\"workload\": \"" << r.workload << "\", \"threads\": " << r.threads
+              << ", \"reclaimer\": \"" << r.reclaimer << "\", \"mode\": \"" << r.mode << "\", \"threshold\": " << r.threshold << ", \"seconds\": " << r.seconds
+              << ", \"ops\": " << r.ops << ", \"ops_per_sec\": " << static_cast<std::uint64_t>(r.ops / r.seconds)
+              << ", \"reads\": " << r.reads << ", \"writes\": " << r.writes
+              << ", \"peak_unreclaimed\": ";
+    if (r.peak_unreclaimed)
+        std::cout << *r.peak_unreclaimed;
+    else
+        std::cout << "null";
+    std::cout << ", ";
+    print_json_histogram("read_latency", r.read_latency);
+    std::cout << ", ";
+    print_json_histogram("write_latency", r.write_latency);
+    std::cout << ", ";
+    print_json_histogram("reclaim_latency", r.reclaim_latency);
+    std::cout << "}";
+}
+
+std::vector<unsigned> parse_list(const std::string& s)
+{
+    std::vector<unsigned> result;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        result.push_back(static_cast<unsigned>(std::stoul(item)));
+    return result;
+}
+
+}
+
+int main(int argc, char const *argv[])
+{
+    std::string workload_name = "all";
+    std::vector<unsigned> thread_counts = {1, 2, 4, 8};
+    unsigned duration_ms = 1000;
+    std::size_t threshold = 100;
+    std::string reclaimer = "epoch";
+    std::string format = "csv";
+    std::size_t advance_step = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            std::cerr << "missing value for " << arg << '\n';
+            return 1;
+        }
+        const std::string value = argv[++i];
+        if (arg == "--workload")
+            workload_name = value;
+        else if (arg == "--threads")
+            thread_counts = parse_list(value);
+        else if (arg == "--duration")
+            duration_ms = static_cast<unsigned>(std::stoul(value));
+        else if (arg == "--threshold")
+            threshold = std::stoul(value);
+        else if (arg == "--reclaimer")
+            reclaimer = value;
+        else if (arg == "--format")
+            format = value;
+        else if (arg == "--advance-step")
+            advance_step = std::stoul(value);
+        else
+        {
+            std::cerr << "unknown option " << arg << '\n';
+            return 1;
+        }
+    }
+
+    std::vector<const workload*> selected;
+    for (auto& w : workloads)
+        if (workload_name == "all" || workload_name == w.name)
+            selected.push_back(&w);
+    if (selected.empty() || (format != "csv" && format != "json") || (reclaimer != "epoch" && reclaimer != "qsbr"))
+    {
+        std::cerr << "unknown workload, format or reclaimer\n";
+        return 1;
+    }
+
+    set_advance_step(advance_step);
+
+    if (format == "csv")
+        print_csv_header();
+    else
+        std::cout << "[\n";
+
+    bool first = true;
+    for (auto w : selected)
+        for (auto threads : thread_counts)
+        {
+            auto r = run(*w, threads, duration_ms, w->threshold == any_threshold ? threshold : w->threshold, reclaimer);
+            if (format == "csv")
+                print_csv(r);
+            else
+                print_json(r, first);
+            first = false;
+            std::cout.flush();
+        }
+
+    if (format == "json")
+        std::cout << "\n]\n";
+    return 0;
+}
@@ -0,0 +1,90 @@
+#ifndef _DEFERRED_CHUNK_
+#define _DEFERRED_CHUNK_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace reclamation { namespace techniques { namespace utils {
+
+// A fixed size arena of callbacks that were deferred by the same thread. Every callback is moved
+// into the arena behind a small header, so deferring does not allocate per callback. Once full
+// (or once the thread's epoch changes) the whole chunk is retired as a single object, and
+// reclaim runs and destroys the callbacks in the order they were deferred.
+class deferred_chunk {
+public:
+    // capacity is chosen so that a chunk occupies exactly 1KiB
+    static constexpr std::size_t alignment = alignof(std::max_align_t);
+    static constexpr std::size_t capacity = 1024 - alignment;
+
+    deferred_chunk() = default;
+    deferred_chunk(const deferred_chunk&) = delete;
+    deferred_chunk& operator=(const deferred_chunk&) = delete;
+
+    template <class F>
+    static constexpr std::size_t entry_size() {
+        return round_up(sizeof(header)) + round_up(sizeof(F));
+    }
+
+    bool empty() const { return used == 0; }
+
+    // Moves f into the chunk. Returns false (leaving f untouched) if there is not enough room left.
+    template <class F>
+    bool try_push(F&& f) {
+        using callback = std::decay_t<F>;
+        static_assert(alignof(callback) <= alignment, "over-aligned callbacks are not supported");
+        static_assert(entry_size<callback>() <= capacity, "the callback is too large to be deferred");
+
+        if (used + entry_size<callback>() > capacity)
+            return false;
+
+        auto entry = storage + used;
+        new (entry + round_up(sizeof(header))) callback(std::forward<F>(f));
+        new (entry) header{&invoke<callback>, static_cast<std::uint32_t>(entry_size<callback>())};
+        used += entry_size<callback>();
+        return true;
+    }
+
+    // Runs all callbacks in the chunks and deletes them.
+    static void reclaim(void* const* objects, std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            auto chunk = static_cast<deferred_chunk*>(objects[i]);
+            for (std::size_t offset = 0; offset < chunk->used;)
+            {
+                auto entry = reinterpret_cast<header*>(chunk->storage + offset);
+                entry->invoke(chunk->storage + offset + round_up(sizeof(header)));
+                offset += entry->size;
+            }
+            delete chunk;
+        }
+    }
+
+private:
+    struct header {
+        // calls and destroys the callback
+        void (*invoke)(void* callback);
+        std::uint32_t size;
+    };
+
+    static constexpr std::size_t round_up(std::size_t size) {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+
+    template <class F>
+    static void invoke(void* p) {
+        auto& f = *static_cast<F*>(p);
+        f();
+        f.~F();
+    }
+
+    alignas(alignment) unsigned char storage[capacity];
+    std::size_t used = 0;
+};
+
+}}}
+
+#endif
@@ -1,27 +1,52 @@
 #ifndef _DELETABLE_OBJECT_
 #define _DELETABLE_OBJECT_
 
+#include <cstddef>
 #include <memory>
 #include <type_traits>
-#include <array>
+
+#include "port.hpp"
 
 namespace reclamation { namespace techniques { namespace utils {
 
 struct deletable_object {
-    deletable_object* next = nullptr;
     virtual void delete_self() = 0;
 
 protected:
     virtual ~deletable_object() = default;
 };
 
-void delete_objects(deletable_object*& list) {
-    auto current = list;
-    for (deletable_object* next = nullptr; current != nullptr; current = next) {
-        next = current->next;
-        current->delete_self();
+// Deletes a batch of retired objects that are all reclaimed the same way.
+using reclaim_function = void (*)(void* const* objects, std::size_t count);
+
+// how many objects ahead the reclaim functions prefetch
+constexpr std::size_t reclaim_prefetch_distance = 4;
+
+// Reclaims objects that were retired as deletable_object*, using virtual dispatch.
+inline void reclaim_deletable_objects(void* const* objects, std::size_t count) {
+    for (std::size_t i = 0; i < count && i < reclaim_prefetch_distance; ++i)
+        PREFETCH(objects[i]);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (i + reclaim_prefetch_distance < count)
+            PREFETCH(objects[i + reclaim_prefetch_distance]);
+        static_cast<deletable_object*>(objects[i])->delete_self();
+    }
+}
+
+// Reclaims objects that were retired as T*, calling the (empty) Deleter directly.
+template <class T, class Deleter>
+void reclaim_objects(void* const* objects, std::size_t count) {
+    static_assert(std::is_default_constructible<Deleter>::value, "empty deleters must be default constructible");
+    Deleter deleter{};
+    for (std::size_t i = 0; i < count && i < reclaim_prefetch_distance; ++i)
+        PREFETCH(objects[i]);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (i + reclaim_prefetch_distance < count)
+            PREFETCH(objects[i + reclaim_prefetch_distance]);
+        deleter(static_cast<T*>(objects[i]));
     }
-    list = nullptr;
 }
 
 template <class Derived, class DeleterT, class Base>
@@ -40,6 +65,9 @@ struct deletable_object_with_non_empty_deleter : Base
         new (&deleter_buffer) Deleter(std::move(deleter));
     }
 
+    static void* retire_pointer(Derived* p) { return static_cast<deletable_object*>(p); }
+    static constexpr reclaim_function reclaim = &reclaim_deletable_objects;
+
 private:
     using buffer = typename std::aligned_storage<sizeof(Deleter), alignof(Deleter)>::type;
     buffer deleter_buffer;
@@ -55,6 +83,21 @@ struct deletable_object_with_empty_deleter : Base {
     }
 
     void set_deleter(Deleter deleter) {}
+
+    static void* retire_pointer(Derived* p) { return static_cast<deletable_object*>(p); }
+    static constexpr reclaim_function reclaim = &reclaim_deletable_objects;
+};
+
+// Objects with an empty deleter do not need to store anything, so they can do without a vtable:
+// they are retired as Derived* and reclaimed in batches that invoke the deleter statically.
+template <class Derived, class DeleterT>
+struct statically_deletable_object {
+    using Deleter = DeleterT;
+
+    void set_deleter(Deleter deleter) {}
+
+    static void* retire_pointer(Derived* p) { return p; }
+    static constexpr reclaim_function reclaim = &reclaim_objects<Derived, Deleter>;
 };
 
 template <class Derived, class Deleter = std::default_delete<Derived>, class Base = deletable_object>
@@ -63,21 +106,12 @@ using deletable_object_impl = std::conditional_t<std::is_empty<Deleter>::value,
     deletable_object_with_non_empty_deleter<Derived, Deleter, Base>
 >;
 
-template <unsigned Epochs>
-struct orphan : utils::deletable_object_impl<orphan<Epochs>>
-{
-    const unsigned target_epoch;
-    
-    orphan(unsigned target_epoch, std::array<utils::deletable_object*, Epochs> &retire_lists): target_epoch(target_epoch), retire_lists(retire_lists) {}
-
-    ~orphan() {
-        for (auto p: retire_lists)
-            utils::delete_objects(p);
-    }
-
-private:
-  std::array<utils::deletable_object*, Epochs> retire_lists;
-};
+// Objects with empty deleters are reclaimed statically, all others keep the virtual delete_self path.
+template <class Derived, class Deleter = std::default_delete<Derived>>
+using reclaimable_object_impl = std::conditional_t<std::is_empty<Deleter>::value,
+    statically_deletable_object<Derived, Deleter>,
+    deletable_object_with_non_empty_deleter<Derived, Deleter, deletable_object>
+>;
 
 }}}
 
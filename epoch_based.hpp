@@ -2,48 +2,334 @@
 #define _EPOCH_BASED_
 
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <deque>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "allocation_tracker.hpp"
+#include "asymmetric_fence.hpp"
 #include "concurrent_ptr.hpp"
+#include "deferred_chunk.hpp"
 #include "deletable_object.hpp"
 #include "guard_ptr.hpp"
 #include "port.hpp"
+#include "reclamation_service.hpp"
+#include "recycling_pool.hpp"
+#include "retire_list.hpp"
 #include "thread_block_list.hpp"
+#ifdef EPOCH_BASED_TRACING
+#include <ostream>
+#include "trace.hpp"
+#endif
 
 namespace reclamation { namespace techniques {
 
-template <std::size_t UpdateThreshold>
+// Tag of the default reclamation domain. Every epoch_based<UpdateThreshold, Domain> instantiation is a
+// domain of its own, with its own global epoch, thread registry, retire lists and settings, so
+// independent subsystems can use different tags and a slow reader of one does not hold up reclamation
+// in the others. Objects must be retired to the domain their readers are guarded by.
+struct default_epoch_domain {};
+
+template <std::size_t UpdateThreshold, class Domain = default_epoch_domain>
 class epoch_based {
     template <class T, class MarkedPtr>
     class guard_ptr;
 
+    static constexpr unsigned number_epochs = 3;
+
+    struct thread_data;
+
 public:
     template <class T, std::size_t N = 0, class Deleter = std::default_delete<T>>
     class enable_concurrent_ptr;
 
-    class region_guard {};
+    class region_guard;
 
     template <class T, std::size_t N = T::number_of_mark_bits>
     using concurrent_ptr = utils::concurrent_ptr<T, N, guard_ptr>;
 
+    // A handle to the calling thread's reclamation state. Guards and region guards constructed with
+    // a context never look up the thread_local state, and guards without one cache it on first use.
+    // A context must only be used by the thread that obtained it.
+    class thread_context {
+    public:
+        bool operator==(const thread_context& other) const { return data == other.data; }
+        bool operator!=(const thread_context& other) const { return data != other.data; }
+
+    private:
+        explicit thread_context(thread_data& data) : data(&data) {}
+        thread_data* data;
+
+        friend epoch_based;
+        template <class, class>
+        friend class guard_ptr;
+        friend class region_guard;
+    };
+
+    static thread_context get_thread_context();
+
+    // Upper bounds for retired objects that have not been reclaimed yet; 0 means unlimited.
+    // Once a thread reaches one of them, it forces epoch updates and reclaims as soon as it
+    // leaves its critical region instead of waiting for UpdateThreshold entries.
+    struct retire_limits {
+        std::size_t thread_objects = 0;
+        std::size_t thread_bytes = 0;
+        std::size_t global_objects = 0;
+        std::size_t global_bytes = 0;
+    };
+
+    // Passed to the retire_limit_handler when forced reclamation could not bring the pending
+    // retired objects back under the limits.
+    struct retire_limit_report {
+        std::size_t thread_objects;
+        std::size_t thread_bytes;
+        std::size_t global_objects;
+        std::size_t global_bytes;
+        // true if an epoch update failed because some thread is still in its critical region
+        bool blocked_by_reader;
+    };
+
+    using retire_limit_handler = void (*)(const retire_limit_report&);
+
+    static void set_retire_limits(const retire_limits& limits);
+    static retire_limits get_retire_limits();
+    static void set_retire_limit_handler(retire_limit_handler handler);
+
+    // Number of retired objects and bytes that have not been reclaimed yet, summed over all threads.
+    // Each thread publishes its counts in batches, so the values may lag behind slightly.
+    static std::pair<std::size_t, std::size_t> pending_retired();
+
+    // Starts background threads that run the deleters of expired retire lists. While the service
+    // is running, expired lists are handed over in O(1) and threads entering a critical region
+    // never run destructors themselves. Handed over objects no longer count as pending.
+    static void start_reclamation_service(unsigned threads = 1);
+
+    // Stops the background threads after they have reclaimed everything handed over to them.
+    static void stop_reclamation_service();
+
+    // Waits until the global epoch has advanced twice since the call, so that every critical region
+    // that was active at that time has ended. Forces epoch updates and yields while some thread
+    // blocks them. Must not be called inside a critical region.
+    static void synchronize();
+
+    // Like synchronize, but also reclaims everything the calling thread retired before the call, as
+    // well as the retired objects abandoned by terminated threads. While the reclamation service is
+    // running, they are handed over to it instead.
+    static void flush();
+
+    // Calls f once every critical region that is active at the time of the call has ended, like
+    // retiring an object that is not a node (e.g., a buffer, a file descriptor or an entry of a
+    // foreign allocator). f is moved into per-thread storage of the current epoch without a heap
+    // allocation; the storage is retired as a whole, so it counts as a single retired object in
+    // limits and statistics. f must not throw and may be called on any thread.
+    template <class F>
+    static void defer(F&& f);
+
+    // Limits the work a thread spends on reclamation per critical region entry and per reclaim call.
+    // Expired retire lists are moved to a per-thread queue of reclaimable objects, of which every such
+    // call deletes at most max_objects objects and stops once max_time has elapsed (checked every few
+    // objects). Zero disables the respective limit; with both disabled (the default) expired lists
+    // are reclaimed at once. Forced reclamation due to retire limits ignores the budget.
+    static void set_reclamation_budget(std::size_t max_objects,
+                                       std::chrono::nanoseconds max_time = std::chrono::nanoseconds::zero());
+
+    static constexpr std::uint32_t no_thread = ~std::uint32_t(0);
+
+    // Reclamation counters of a single thread. Every thread owns the counters in its control block,
+    // which is reused by later threads once it exits, so the counters of a slot are cumulative over
+    // all threads that have used it.
+    struct thread_statistics {
+        // the thread's announcement slot; it does not change during the thread's lifetime
+        std::uint32_t thread = 0;
+        bool registered = false;
+        bool in_critical_region = false;
+
+        std::size_t epoch_advances = 0;
+        std::size_t failed_advances = 0;
+        // failed advances of other threads that found this thread in the old epoch
+        std::size_t blocked_advances = 0;
+        // slot of the thread that blocked the most recent failed advance, if any
+        std::uint32_t last_blocker = no_thread;
+
+        std::size_t retired_objects = 0;
+        std::size_t retired_bytes = 0;
+        // includes objects handed over to the reclamation service
+        std::size_t reclaimed_objects = 0;
+        std::size_t reclaimed_bytes = 0;
+        std::size_t orphans_created = 0;
+        std::size_t orphans_adopted = 0;
+
+        // retired objects that have not expired yet, by epoch bucket (the epoch modulo number_epochs),
+        // and expired objects waiting for the reclamation budget; updated in batches like pending_retired
+        std::array<std::size_t, number_epochs> pending_objects = {};
+        std::size_t ready_objects = 0;
+    };
+
+    struct statistics {
+        std::uint64_t global_epoch = 0;
+        // the sums over all threads; thread, registered, in_critical_region and last_blocker are not set
+        thread_statistics total;
+        std::vector<thread_statistics> threads;
+    };
+
+    // Collects the counters of all threads. The counters are read one by one while the threads keep
+    // running, so the result is not an atomic snapshot, but it never blocks anybody.
+    static statistics snapshot();
+
+    // A thread that is still in the previous epoch and therefore prevents the epoch from advancing.
+    struct stalled_thread {
+        // the thread's announcement slot, as in thread_statistics
+        std::uint32_t thread;
+        std::string label;
+        // how long the thread has been in its critical region; zero if stall detection was
+        // disabled when it entered
+        std::chrono::nanoseconds in_critical_region;
+        // total number of failed advances this thread's slot has blocked
+        std::size_t blocked_advances;
+    };
+
+    // Labels the calling thread in stall reports. At most max_label_length characters are kept.
+    static constexpr std::size_t max_label_length = 31;
+    static void set_thread_label(const char* label);
+
+    // Records the time of every (outermost) critical region entry, so that stalls can be measured.
+    // Disabled by default, as it costs a clock read per entry.
+    static void set_stall_detection(bool enabled);
+
+    // Returns the threads that block the epoch update and have been in their critical region for
+    // at least min_duration. Without stall detection, all blocking threads are reported for a
+    // min_duration of zero and none otherwise.
+    static std::vector<stalled_thread> stalled_threads(std::chrono::nanoseconds min_duration = std::chrono::nanoseconds::zero());
+
+    // Called by a thread whose epoch update failed once the same thread has blocked repeated_blocks
+    // consecutive update attempts, and again for every further repeated_blocks attempts. The handler
+    // runs inside the updating thread's critical region, so it must not wait for reclamation.
+    using stall_handler = void (*)(const stalled_thread&);
+    static void set_stall_handler(stall_handler handler, std::size_t repeated_blocks = 64);
+
+    // Amortized epoch updates: instead of scanning all threads every UpdateThreshold entries, each
+    // critical region entry advances a per-thread cursor over the announcements of up to
+    // threads_per_entry other threads. The cursor waits at a thread that is still in the old epoch,
+    // and once it has passed everyone the update is attempted (and validated by a full scan).
+    // UpdateThreshold is ignored in this mode. 0 (the default) disables the cursor.
+    static void set_epoch_advance_step(std::size_t threads_per_entry);
+
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+    // Hybrid mode: every guard_ptr also publishes its pointer in a per-thread hazard slot. Once
+    // max_failed_updates consecutive epoch update attempts have failed, or the epoch has been
+    // blocked for max_blocked_time, the threads that still block the update are ejected: the epoch
+    // advances without them, objects they guard are kept alive by their hazard slots, and until
+    // they leave their critical region they validate every acquired pointer like hazard pointers.
+    // A thread that holds a region_guard (or more guards than it has hazard slots) relies on the
+    // epoch alone and is never ejected. Zero disables the respective trigger; by default
+    // nobody is ejected.
+    static void set_hazard_fallback(std::size_t max_failed_updates,
+                                    std::chrono::nanoseconds max_blocked_time = std::chrono::nanoseconds::zero());
+
+    // Number of times a thread has been ejected so far.
+    static std::size_t ejected_readers();
+#endif
+
+#ifdef EPOCH_BASED_TRACING
+    // Tracing mode: every thread records its epoch advances, failed update attempts, orphan adoptions
+    // and reclamation bursts in a ring buffer of the most recent trace_buffer::capacity events, and
+    // the time between retiring and freeing objects in a histogram. Retire times are sampled per retire
+    // chunk, i.e., every object counts with the time its chunk was opened; objects handed over to the
+    // reclamation service count until the handover.
+    static utils::age_histogram retire_ages();
+
+    // Writes the recorded events of all threads in the Chrome trace event format (chrome://tracing,
+    // Perfetto). Threads are identified by their announcement slot and named by their label.
+    static void write_chrome_trace(std::ostream& out);
+#endif
+
     ALLOCATION_TRACKER;
 
 private:
-    static constexpr unsigned number_epochs = 3;
+#ifdef EPOCH_BASED_MONOTONIC_EPOCHS
+    // The global epoch only ever increases and every retired object is stamped with the epoch it was
+    // retired in. Objects are reclaimed as soon as no thread can still be in an epoch that allows
+    // access to them, instead of whenever their bucket of the ring of number_epochs lists comes around.
+    using epoch_t = std::uint64_t;
+    static constexpr epoch_t next_epoch(epoch_t epoch) { return epoch + 1; }
+    static constexpr epoch_t previous_epoch(epoch_t epoch) { return epoch - 1; }
+#else
+    using epoch_t = unsigned;
+    static constexpr epoch_t next_epoch(epoch_t epoch) { return (epoch + 1) % number_epochs; }
+    static constexpr epoch_t previous_epoch(epoch_t epoch) { return (epoch + number_epochs - 1) % number_epochs; }
+#endif
 
-    struct thread_data;
     struct thread_control_block;
 
-    static std::atomic<unsigned> global_epoch;
-    static utils::thread_block_list<thread_control_block> global_thread_block_list;
+    struct retirement_state {
+        std::atomic<std::size_t> budget_objects;
+        std::atomic<std::chrono::nanoseconds::rep> budget_time;
+
+        std::atomic<std::size_t> thread_objects_limit;
+        std::atomic<std::size_t> thread_bytes_limit;
+        std::atomic<std::size_t> global_objects_limit;
+        std::atomic<std::size_t> global_bytes_limit;
+        std::atomic<retire_limit_handler> handler;
+
+        std::atomic<std::size_t> pending_objects;
+        std::atomic<std::size_t> pending_bytes;
+
+        std::atomic<std::size_t> advance_step;
+
+        std::atomic<bool> stall_detection;
+        std::atomic<stall_handler> stall_callback;
+        std::atomic<std::size_t> stall_repeats;
+        // the thread that blocked the most recent update attempts and the number of those attempts
+        std::atomic<std::uint32_t> streak_thread;
+        std::atomic<std::size_t> streak_length;
+
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+        std::atomic<std::size_t> eject_after_failed_updates;
+        std::atomic<std::chrono::nanoseconds::rep> eject_after_blocked_time;
+        // consecutive failed update attempts and the time of the first one (0 if there is none)
+        std::atomic<std::size_t> failed_updates;
+        std::atomic<std::chrono::nanoseconds::rep> blocked_since;
+        std::atomic<std::size_t> ejections;
+#endif
+    };
+
+    static std::atomic<epoch_t> global_epoch;
+    static retirement_state retirement;
+    static utils::reclamation_service reclamation_service;
+    static utils::thread_block_list<thread_control_block, utils::orphan> global_thread_block_list;
     static thread_data& local_thread_data();
 
     ALLOCATION_TRACKING_FUNCTIONS;
 };
 
-template <std::size_t UpdateThreshold>
+// Keeps the current thread inside a critical region for the guard's lifetime.
+// The region is entered once on construction, so all guard_ptr operations performed
+// while the region_guard is alive only adjust the nesting count and never fence.
+template <std::size_t UpdateThreshold, class Domain>
+class epoch_based<UpdateThreshold, Domain>::region_guard {
+public:
+    region_guard() ;
+    explicit region_guard(thread_context context) ;
+    ~region_guard() ;
+
+    region_guard(const region_guard&) = delete;
+    region_guard(region_guard&&) = delete;
+    region_guard& operator=(const region_guard&) = delete;
+    region_guard& operator=(region_guard&&) = delete;
+
+private:
+    thread_data& data;
+};
+
+template <std::size_t UpdateThreshold, class Domain>
 template <class T, std::size_t N, class Deleter>
-class epoch_based<UpdateThreshold>::enable_concurrent_ptr : private utils::deletable_object_impl<T, Deleter>, private utils::tracked_object<epoch_based> {
+class epoch_based<UpdateThreshold, Domain>::enable_concurrent_ptr : private utils::reclaimable_object_impl<T, Deleter>, private utils::tracked_object<epoch_based> {
 public:
     static constexpr std::size_t number_of_mark_bits = N;
 
@@ -56,20 +342,22 @@ protected:
     ~enable_concurrent_ptr() = default;
 
 private:
-    friend utils::deletable_object_impl<T, Deleter>;
+    friend utils::reclaimable_object_impl<T, Deleter>;
 
     template <class, class>
     friend class guard_ptr;
 };
 
-template <std::size_t UpdateThreshold>
+template <std::size_t UpdateThreshold, class Domain>
 template <class T, class MarkedPtr>
-class epoch_based<UpdateThreshold>::guard_ptr : public utils::guard_ptr<T, MarkedPtr, guard_ptr<T, MarkedPtr>> {
+class epoch_based<UpdateThreshold, Domain>::guard_ptr : public utils::guard_ptr<T, MarkedPtr, guard_ptr<T, MarkedPtr>> {
     using base = utils::guard_ptr<T, MarkedPtr, guard_ptr>;
     using Deleter = typename T::Deleter;
 public:
     // Guard a marked ptr.
     guard_ptr(const MarkedPtr& p = MarkedPtr()) ;
+    // Like above, but all operations of this guard use the given context.
+    explicit guard_ptr(thread_context context, const MarkedPtr& p = MarkedPtr()) ;
     explicit guard_ptr(const guard_ptr& p) ;
     guard_ptr(guard_ptr&& p) ;
 
@@ -89,55 +377,121 @@ public:
 
     // Reset. Deleter d will be applied some time after all owners release their ownership.
     void reclaim(Deleter d = Deleter()) ;
+
+    // The context this guard operates on; a guard without one looks up the calling thread's.
+    thread_context get_context() { return thread_context(local_data()); }
+
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+    void do_swap(guard_ptr& g) { std::swap(hazard_slot, g.hazard_slot); }
+#endif
+
+private:
+    thread_data& local_data() {
+        if (context == nullptr)
+            context = &local_thread_data();
+        return *context;
+    }
+
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+    // Publishes the current pointer in this guard's hazard slot; returns false if the thread
+    // has been ejected, in which case the pointer has to be validated.
+    bool protect() ;
+
+    unsigned hazard_slot = thread_data::no_hazard_slot;
+#endif
+    // the owning thread's data, looked up on first use
+    thread_data* context = nullptr;
 };
 
-template <std::size_t UpdateThreshold>
+template <std::size_t UpdateThreshold, class Domain>
 template <class T, class MarkedPtr>
-epoch_based<UpdateThreshold>::guard_ptr<T, MarkedPtr>::guard_ptr(const MarkedPtr& p) : base(p) {
+epoch_based<UpdateThreshold, Domain>::guard_ptr<T, MarkedPtr>::guard_ptr(const MarkedPtr& p) : base(p) {
     if (this->ptr)
-        local_thread_data().enter_critical();
+    {
+        local_data().enter_critical();
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+        // the caller already keeps p alive, so it does not need to be validated
+        protect();
+#endif
+    }
 }
 
-template <std::size_t UpdateThreshold>
+template <std::size_t UpdateThreshold, class Domain>
 template <class T, class MarkedPtr>
-epoch_based<UpdateThreshold>::guard_ptr<T, MarkedPtr>::guard_ptr(const guard_ptr& p) : guard_ptr(MarkedPtr(p)) {}
+epoch_based<UpdateThreshold, Domain>::guard_ptr<T, MarkedPtr>::guard_ptr(thread_context context, const MarkedPtr& p) :
+    base(p), context(context.data) {
+    if (this->ptr)
+    {
+        this->context->enter_critical();
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+        protect();
+#endif
+    }
+}
 
-template <std::size_t UpdateThreshold>
+template <std::size_t UpdateThreshold, class Domain>
 template <class T, class MarkedPtr>
-epoch_based<UpdateThreshold>::guard_ptr<T, MarkedPtr>::guard_ptr(guard_ptr&& p) : base(p.ptr) {
+epoch_based<UpdateThreshold, Domain>::guard_ptr<T, MarkedPtr>::guard_ptr(const guard_ptr& p) : base(p.ptr), context(p.context) {
+    if (this->ptr)
+    {
+        local_data().enter_critical();
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+        protect();
+#endif
+    }
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+template <class T, class MarkedPtr>
+epoch_based<UpdateThreshold, Domain>::guard_ptr<T, MarkedPtr>::guard_ptr(guard_ptr&& p) : base(p.ptr), context(p.context) {
     p.ptr.reset();
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+    std::swap(hazard_slot, p.hazard_slot);
+#endif
 }
 
-template <std::size_t UpdateThreshold>
+template <std::size_t UpdateThreshold, class Domain>
 template <class T, class MarkedPtr>
-auto epoch_based<UpdateThreshold>::guard_ptr<T, MarkedPtr>::operator=(const guard_ptr& p) -> guard_ptr& {
+auto epoch_based<UpdateThreshold, Domain>::guard_ptr<T, MarkedPtr>::operator=(const guard_ptr& p) -> guard_ptr& {
     if (&p == this)
         return *this;
 
     reset();
     this->ptr = p.ptr;
+    if (p.context != nullptr)
+        context = p.context;
     if (this->ptr)
-        local_thread_data().enter_critical();
+    {
+        local_data().enter_critical();
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+        protect();
+#endif
+    }
 
     return *this;
 }
 
-template <std::size_t UpdateThreshold>
+template <std::size_t UpdateThreshold, class Domain>
 template <class T, class MarkedPtr>
-auto epoch_based<UpdateThreshold>::guard_ptr<T, MarkedPtr>::operator=(guard_ptr&& p) -> guard_ptr& {
+auto epoch_based<UpdateThreshold, Domain>::guard_ptr<T, MarkedPtr>::operator=(guard_ptr&& p) -> guard_ptr& {
     if (&p == this)
         return *this;
 
     reset();
     this->ptr = std::move(p.ptr);
     p.ptr.reset();
+    if (p.context != nullptr)
+        context = p.context;
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+    std::swap(hazard_slot, p.hazard_slot);
+#endif
 
     return *this;
 }
 
-template <std::size_t UpdateThreshold>
+template <std::size_t UpdateThreshold, class Domain>
 template <class T, class MarkedPtr>
-void epoch_based<UpdateThreshold>::guard_ptr<T, MarkedPtr>::acquire(const concurrent_ptr<T>& p, std::memory_order order)  {
+void epoch_based<UpdateThreshold, Domain>::guard_ptr<T, MarkedPtr>::acquire(const concurrent_ptr<T>& p, std::memory_order order)  {
     if (p.load(std::memory_order_relaxed) == nullptr)
     {
         reset();
@@ -145,16 +499,35 @@ void epoch_based<UpdateThreshold>::guard_ptr<T, MarkedPtr>::acquire(const concur
     }
 
     if (!this->ptr)
-        local_thread_data().enter_critical();
+        local_data().enter_critical();
     // (1) - this load operation potentially synchronizes-with any release operation on p.
     this->ptr = p.load(order);
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+    // An ejected thread is not protected by its epoch, so like with hazard pointers the
+    // pointer is only safe if p still holds it after the hazard has been published.
+    while (this->ptr && !protect())
+    {
+        // (10) - this seq_cst-fence enforces a total order with the seq_cst-fence (11)
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto actual = p.load(order);
+        if (actual == this->ptr)
+            break;
+        this->ptr = actual;
+    }
+    if (!this->ptr)
+    {
+        local_data().release_hazard_slot(hazard_slot);
+        local_data().leave_critical();
+    }
+#else
     if (!this->ptr)
-        local_thread_data().leave_critical();
+        local_data().leave_critical();
+#endif
 }
 
-template <std::size_t UpdateThreshold>
+template <std::size_t UpdateThreshold, class Domain>
 template <class T, class MarkedPtr>
-bool epoch_based<UpdateThreshold>::guard_ptr<T, MarkedPtr>::acquire_if_equal(
+bool epoch_based<UpdateThreshold, Domain>::guard_ptr<T, MarkedPtr>::acquire_if_equal(
     const concurrent_ptr<T>& p,
     const MarkedPtr& expected,
     std::memory_order order) 
@@ -167,142 +540,1043 @@ bool epoch_based<UpdateThreshold>::guard_ptr<T, MarkedPtr>::acquire_if_equal(
     }
 
     if (!this->ptr)
-        local_thread_data().enter_critical();
+        local_data().enter_critical();
     // (2) - this load operation potentially synchronizes-with any release operation on p
     this->ptr = p.load(order);
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+    while (this->ptr && this->ptr == expected && !protect())
+    {
+        // (10) - this seq_cst-fence enforces a total order with the seq_cst-fence (11)
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto actual = p.load(order);
+        if (actual == this->ptr)
+            break;
+        this->ptr = actual;
+    }
+#endif
     if (!this->ptr || this->ptr != expected)
     {
-        local_thread_data().leave_critical();
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+        local_data().release_hazard_slot(hazard_slot);
+#endif
+        local_data().leave_critical();
         this->ptr.reset();
     }
 
     return this->ptr == expected;
 }
 
-template <std::size_t UpdateThreshold>
+template <std::size_t UpdateThreshold, class Domain>
 template <class T, class MarkedPtr>
-void epoch_based<UpdateThreshold>::guard_ptr<T, MarkedPtr>::reset() {
+void epoch_based<UpdateThreshold, Domain>::guard_ptr<T, MarkedPtr>::reset() {
     if (this->ptr)
-        local_thread_data().leave_critical();
+    {
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+        local_data().release_hazard_slot(hazard_slot);
+#endif
+        local_data().leave_critical();
+    }
     this->ptr.reset();
 }
 
-template <std::size_t UpdateThreshold>
+template <std::size_t UpdateThreshold, class Domain>
 template <class T, class MarkedPtr>
-void epoch_based<UpdateThreshold>::guard_ptr<T, MarkedPtr>::reclaim(Deleter d) {
+void epoch_based<UpdateThreshold, Domain>::guard_ptr<T, MarkedPtr>::reclaim(Deleter d) {
     this->ptr->set_deleter(std::move(d));
-    local_thread_data().add_retired_node(this->ptr.get());
+    local_data().add_retired_node(T::retire_pointer(this->ptr.get()), T::reclaim, sizeof(T));
     reset();
 }
 
-template <std::size_t UpdateThreshold>
-struct epoch_based<UpdateThreshold>::thread_control_block : utils::thread_block_list<thread_control_block>::entry {
-    thread_control_block() : is_in_critical_region(false), local_epoch(number_epochs) {}
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+template <std::size_t UpdateThreshold, class Domain>
+template <class T, class MarkedPtr>
+bool epoch_based<UpdateThreshold, Domain>::guard_ptr<T, MarkedPtr>::protect() {
+    return local_data().publish_hazard(hazard_slot, T::retire_pointer(this->ptr.get()));
+}
+#endif
+
+template <std::size_t UpdateThreshold, class Domain>
+epoch_based<UpdateThreshold, Domain>::region_guard::region_guard() : region_guard(get_thread_context()) {}
+
+template <std::size_t UpdateThreshold, class Domain>
+epoch_based<UpdateThreshold, Domain>::region_guard::region_guard(thread_context context) : data(*context.data) {
+    data.enter_critical();
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+    // code inside the region may use raw pointers, which hazard slots cannot protect
+    data.pin();
+#endif
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+epoch_based<UpdateThreshold, Domain>::region_guard::~region_guard() {
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+    data.unpin();
+#endif
+    data.leave_critical();
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+struct epoch_based<UpdateThreshold, Domain>::thread_control_block : utils::thread_block_list<thread_control_block>::entry {
+    // The announced local epoch and the "in critical region" flag packed into a single word, so that
+    // entering/leaving is a single store and scanning a thread is a single load.
+#ifdef EPOCH_BASED_MONOTONIC_EPOCHS
+    // Only the low bits of a monotonic epoch fit into the announcement. Threads in their critical
+    // region lag behind the global epoch by at most one, so the truncated values are unambiguous;
+    // the two top bits stay clear for the hazard fallback's markers.
+    static constexpr epoch_t epoch_mask = (epoch_t(1) << 29) - 1;
+
+    static constexpr unsigned announce(epoch_t epoch, bool in_critical_region) {
+        return static_cast<unsigned>((epoch & epoch_mask) << 1) | (in_critical_region ? 1u : 0u);
+    }
+
+    // How many epochs the epoch in the given announcement lies behind the given epoch.
+    static constexpr epoch_t lag(unsigned announcement, epoch_t epoch) {
+        return (epoch - (announcement >> 1)) & epoch_mask;
+    }
+#else
+    static constexpr unsigned announce(epoch_t epoch, bool in_critical_region) {
+        return (epoch << 1) | (in_critical_region ? 1u : 0u);
+    }
+#endif
+
+    // The announcement lives on its own cache line in the thread_block_list, away from the entry's
+    // state and next_entry fields. Before a thread announces a new epoch, it publishes the
+    // announcement (without the pinned marker) as the entry's hint, so that epoch updates can
+    // sweep the dense hints with vector instructions and only load the announcements they match.
+    bool is_in_critical_region() const {
+        return (this->announcement().load(std::memory_order_relaxed) & 1) != 0;
+    }
+
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+    // Set in the announcement while the thread must not be ejected.
+    static constexpr unsigned pinned = 1u << 30;
+    // Written over the announcement of an ejected thread; it matches no blocking announcement.
+    static constexpr unsigned ejected = ~0u;
+
+    static constexpr unsigned hazard_slots = 8;
+    std::atomic<void*> hazards[hazard_slots] = {};
+#endif
+
+    // Statistics are only written by the owning thread, except for blocked_advances, so relaxed
+    // loads and stores suffice and no read-modify-write operation is necessary.
+    struct counters {
+        std::atomic<std::size_t> epoch_advances{0};
+        std::atomic<std::size_t> failed_advances{0};
+        std::atomic<std::size_t> blocked_advances{0};
+        std::atomic<std::uint32_t> last_blocker{no_thread};
+        std::atomic<std::size_t> retired_objects{0};
+        std::atomic<std::size_t> retired_bytes{0};
+        std::atomic<std::size_t> reclaimed_objects{0};
+        std::atomic<std::size_t> reclaimed_bytes{0};
+        std::atomic<std::size_t> orphans_created{0};
+        std::atomic<std::size_t> orphans_adopted{0};
+        std::atomic<std::size_t> pending_objects[number_epochs] = {};
+        std::atomic<std::size_t> ready_objects{0};
+    };
+    counters stats;
+
+    // steady_clock time of the last critical region entry in nanoseconds, if stall detection is enabled
+    std::atomic<std::int64_t> entered_at{0};
+    std::array<std::atomic<char>, max_label_length + 1> label = {};
+#ifdef EPOCH_BASED_TRACING
+    utils::trace_buffer trace;
+#endif
+
+    std::string get_label() const {
+        std::string result;
+        for (auto& c : label)
+        {
+            const char ch = c.load(std::memory_order_relaxed);
+            if (ch == '\0')
+                break;
+            result += ch;
+        }
+        return result;
+    }
 
-    std::atomic<bool> is_in_critical_region;
-    std::atomic<unsigned> local_epoch;
+    void set_label(const char* value) {
+        std::size_t i = 0;
+        for (; value != nullptr && value[i] != '\0' && i < max_label_length; ++i)
+            label[i].store(value[i], std::memory_order_relaxed);
+        label[i].store('\0', std::memory_order_relaxed);
+    }
+
+    static std::int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static void add(std::atomic<std::size_t>& counter, std::size_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
 };
 
-template <std::size_t UpdateThreshold>
-struct epoch_based<UpdateThreshold>::thread_data
+template <std::size_t UpdateThreshold, class Domain>
+struct epoch_based<UpdateThreshold, Domain>::thread_data
 {
     void enter_critical() {
         if (++enter_count == 1)
+        {
             do_enter_critical();
+            if (retirement.stall_detection.load(std::memory_order_relaxed))
+                control_block->entered_at.store(thread_control_block::now(), std::memory_order_relaxed);
+        }
+    }
+
+    void set_label(const char* label) {
+        ensure_has_control_block();
+        control_block->set_label(label);
+    }
+
+    template <class F>
+    void defer(F&& f) {
+        enter_critical();
+        if (deferred != nullptr && !deferred->try_push(std::forward<F>(f)))
+            retire_deferred();
+        if (deferred == nullptr)
+        {
+            deferred = new utils::deferred_chunk();
+            const bool pushed = deferred->try_push(std::forward<F>(f));
+            assert(pushed);
+            (void)pushed;
+        }
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+        // local_epoch is stale, so the callback must not wait in the chunk of an epoch
+        if (is_ejected())
+            retire_deferred();
+#endif
+        leave_critical();
+    }
+
+    void synchronize() {
+        assert(enter_count == 0);
+        // the first entry only catches up with the global epoch; advances before the call do not count
+        enter_and_leave(false);
+        auto epoch = local_epoch;
+        for (epoch_t advances = 0; advances < 2;)
+        {
+            if (!enter_and_leave(true))
+                std::this_thread::yield();
+            if (local_epoch != epoch)
+            {
+#ifdef EPOCH_BASED_MONOTONIC_EPOCHS
+                advances += local_epoch - epoch;
+#else
+                // the epoch may have advanced more than once, but counting too few is safe
+                ++advances;
+#endif
+                epoch = local_epoch;
+            }
+        }
+    }
+
+    void flush() {
+        assert(enter_count == 0);
+        ensure_has_control_block();
+        if (deferred != nullptr)
+            retire_deferred();
+        adopt_orphans();
+
+        // Objects retired by destructors while we synchronize have to wait for the regular
+        // reclamation, so we take the lists before.
+        utils::retire_list retired;
+        std::size_t objects = 0;
+        std::size_t bytes = 0;
+#ifdef EPOCH_BASED_MONOTONIC_EPOCHS
+        for (auto& list : retire_lists)
+        {
+            retired.append(list.nodes);
+            objects += list.objects;
+            bytes += list.bytes;
+        }
+        retire_lists.clear();
+#else
+        for (unsigned i = 0; i < number_epochs; ++i)
+            retired.append(retire_lists[i]);
+        objects = std::accumulate(retired_objects.begin(), retired_objects.end(), std::size_t(0));
+        bytes = std::accumulate(retired_bytes.begin(), retired_bytes.end(), std::size_t(0));
+        retired_objects = {};
+        retired_bytes = {};
+#endif
+
+        synchronize();
+        reclaim_retire_list(retired, objects, bytes, true);
+        while (!ready_list.empty())
+            reclaim_ready_objects(true);
+
+        if (!retired.empty())
+        {
+            // objects that are still guarded by hazard slots of ejected threads
+#ifdef EPOCH_BASED_MONOTONIC_EPOCHS
+            if (retire_lists.empty() || retire_lists.back().epoch != local_epoch)
+                retire_lists.emplace_back(local_epoch);
+            auto& list = retire_lists.back();
+            list.nodes.append(retired);
+            list.objects += objects;
+            list.bytes += bytes;
+#else
+            retire_lists[local_epoch].append(retired);
+            retired_objects[local_epoch] += objects;
+            retired_bytes[local_epoch] += bytes;
+#endif
+        }
+        publish_pending();
     }
 
     void leave_critical() {
         assert(enter_count > 0);
         if (--enter_count == 0)
+        {
             do_leave_critical();
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+            if (!ejected_list.empty())
+                abandon_ejected_list();
+#endif
+            if (limit_reached)
+                force_reclaim();
+        }
     }
 
-    void add_retired_node(utils::deletable_object* p) {
-        add_retired_node(p, control_block->local_epoch.load(std::memory_order_relaxed));
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+    static constexpr unsigned no_hazard_slot = ~0u;
+    // used by guards that found no free hazard slot; they pin the thread instead
+    static constexpr unsigned pinning_slot = ~0u - 1;
+
+    bool publish_hazard(unsigned& slot, void* p) {
+        if (slot == no_hazard_slot)
+        {
+            if (free_hazard_slots == 0)
+            {
+                // p was loaded while we might have been ejected, so it has to be validated
+                // if pinning made us rejoin
+                slot = pinning_slot;
+                return pin();
+            }
+            slot = 0;
+            while ((free_hazard_slots & (1u << slot)) == 0)
+                ++slot;
+            free_hazard_slots &= ~(1u << slot);
+        }
+        if (slot == pinning_slot)
+            return true;
+
+        control_block->hazards[slot].store(p, std::memory_order_relaxed);
+        // (12) - this light fence pairs with the heavy fence (13)
+        utils::asymmetric_fence::light();
+        return !is_ejected();
+    }
+
+    void release_hazard_slot(unsigned& slot) {
+        if (slot == pinning_slot)
+            unpin();
+        else if (slot != no_hazard_slot)
+        {
+            // release, so that anyone who sees the slot cleared also sees hazards stored before
+            control_block->hazards[slot].store(nullptr, std::memory_order_release);
+            free_hazard_slots |= 1u << slot;
+        }
+        slot = no_hazard_slot;
+    }
+
+    // Returns false if the thread had been ejected and had to rejoin.
+    bool pin() {
+        assert(enter_count > 0);
+        if (pin_count++ != 0)
+            return true;
+
+        auto& word = control_block->announcement();
+        auto expected = thread_control_block::announce(local_epoch, true);
+        if (word.compare_exchange_strong(expected, expected | thread_control_block::pinned, std::memory_order_relaxed))
+            return true;
+
+        // We have been ejected, so we have to block epoch updates again before we can rely on the
+        // epoch. Our remaining guards stay protected by their hazard slots. The retire lists of
+        // the skipped epochs are reclaimed with the next transition into their epochs.
+        assert(expected == thread_control_block::ejected);
+        auto epoch = global_epoch.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            control_block->publish_hint(thread_control_block::announce(epoch, true));
+            word.store(thread_control_block::announce(epoch, true) | thread_control_block::pinned, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            // (4) - this acquire-load synchronizes-with the release-CAS (7)
+            auto actual = global_epoch.load(std::memory_order_acquire);
+            if (actual == epoch)
+                break;
+            epoch = actual;
+        }
+        local_epoch = epoch;
+        return false;
+    }
+
+    void unpin() {
+        assert(pin_count > 0);
+        if (--pin_count == 0)
+            control_block->announcement().store(thread_control_block::announce(local_epoch, true), std::memory_order_relaxed);
+    }
+#endif
+
+    void add_retired_node(void* p, utils::reclaim_function reclaim, std::size_t bytes) {
+        if (!ready_list.empty())
+            reclaim_ready_objects(false);
+
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+        if (is_ejected())
+        {
+            // local_epoch is stale, so the object cannot go into one of the epoch's retire lists
+            ejected_list.push(p, reclaim, chunk_pool);
+            ejected_objects += 1;
+            ejected_bytes += bytes;
+            unpublished_objects += 1;
+            unpublished_bytes += bytes;
+            return;
+        }
+#endif
+
+#ifdef EPOCH_BASED_MONOTONIC_EPOCHS
+        if (retire_lists.empty() || retire_lists.back().epoch != local_epoch)
+            retire_lists.emplace_back(local_epoch);
+        auto& list = retire_lists.back();
+        list.nodes.push(p, reclaim, chunk_pool);
+        list.objects += 1;
+        list.bytes += bytes;
+#else
+        assert(local_epoch < number_epochs);
+        retire_lists[local_epoch].push(p, reclaim, chunk_pool);
+        retired_objects[local_epoch] += 1;
+        retired_bytes[local_epoch] += bytes;
+#endif
+        unpublished_objects += 1;
+        unpublished_bytes += bytes;
+        thread_control_block::add(control_block->stats.retired_objects, 1);
+        thread_control_block::add(control_block->stats.retired_bytes, bytes);
+        if (unpublished_objects >= publish_interval)
+            publish_pending();
+
+        // the actual reclamation is deferred until we leave the critical region
+        if (!limit_reached && reached_retire_limits())
+            limit_reached = true;
     }
 
     ~thread_data() {
         if (control_block == nullptr)
             return; // nothing to do
 
+        if (deferred != nullptr)
+            retire_deferred();
+
+        // the objects in the ready list have already expired
+        while (!ready_list.empty())
+            reclaim_ready_objects(true);
+
+#ifdef EPOCH_BASED_MONOTONIC_EPOCHS
+        if (!retire_lists.empty())
+        {
+            // the newest stamp is valid for all of them; adopting threads keep the lists ordered by it
+            const auto epoch = retire_lists.back().epoch;
+            auto& first = retire_lists.front().nodes;
+            for (auto it = std::next(retire_lists.begin()); it != retire_lists.end(); ++it)
+                first.append(it->nodes);
+
+            global_thread_block_list.abandon_retired_nodes(new utils::orphan(epoch, first,
+                thread_pending_objects(), thread_pending_bytes()));
+            thread_control_block::add(control_block->stats.orphans_created, 1);
+            retire_lists.clear();
+        }
+#else
         // we can avoid creating an orphan in case we have no retired nodes left.
-        if (std::any_of(retire_lists.begin(), retire_lists.end(), [](auto p) { return p != nullptr; }))
+        if (std::any_of(retire_lists.begin(), retire_lists.end(), [](auto& l) { return !l.empty(); }))
         {
             // global_epoch - 1 (mod number_epochs) guarantees a full cycle, making sure no
             // other thread may still have a reference to an object in one of the retire lists.
             auto target_epoch = (global_epoch.load(std::memory_order_relaxed) + number_epochs - 1) % number_epochs;
             assert(target_epoch < number_epochs);
-            global_thread_block_list.abandon_retired_nodes(new utils::orphan<number_epochs>(target_epoch, retire_lists));
+
+            // concatenate all retire lists so that they can be adopted in O(1)
+            for (unsigned i = 1; i < number_epochs; ++i)
+                retire_lists[0].append(retire_lists[i]);
+
+            global_thread_block_list.abandon_retired_nodes(new utils::orphan(target_epoch, retire_lists[0],
+                thread_pending_objects(), thread_pending_bytes()));
+            thread_control_block::add(control_block->stats.orphans_created, 1);
+            retired_objects = {};
         }
+#endif
+        // the orphan's objects are still pending, so the global counters keep them until they get reclaimed
+        publish_pending();
 
-        assert(control_block->is_in_critical_region.load(std::memory_order_relaxed) == false);
+        assert(control_block->is_in_critical_region() == false);
+        control_block->set_label(nullptr);
+        control_block->entered_at.store(0, std::memory_order_relaxed);
         global_thread_block_list.release_entry(control_block);
     }
 
 private:
     void ensure_has_control_block() {
         if (control_block == nullptr)
+        {
             control_block = global_thread_block_list.acquire_entry();
+            // an adopted entry still carries the hint of its previous owner
+            control_block->publish_hint(thread_control_block::announce(local_epoch, true));
+        }
     }
 
-    void do_enter_critical() {
+    // Returns false if an epoch update was attempted but some other thread prevented it.
+    bool do_enter_critical(bool force_update = false) {
         ensure_has_control_block();
 
-        control_block->is_in_critical_region.store(true, std::memory_order_relaxed);
+        control_block->announcement().store(thread_control_block::announce(local_epoch, true), std::memory_order_relaxed);
+#ifdef EPOCH_BASED_ASYMMETRIC_FENCE
+        // (3) - this light fence pairs with the heavy fence (8)
+        utils::asymmetric_fence::light();
+#else
         // (3) - this seq_cst-fence enforces a total order with itself
         std::atomic_thread_fence(std::memory_order_seq_cst);
+#endif
 
         // (4) - this acquire-load synchronizes-with the release-CAS (7)
         auto epoch = global_epoch.load(std::memory_order_acquire);
-        if (control_block->local_epoch.load(std::memory_order_relaxed) != epoch) // New epoch?
+        if (local_epoch != epoch) // New epoch?
         {
             entries_since_update = 0;
+            scan_cursor = 0;
         }
-        else if (entries_since_update++ == UpdateThreshold)
+        else if (force_update || should_try_update(epoch))
         {
             entries_since_update = 0;
-            const auto new_epoch = (epoch + 1) % number_epochs;
+            scan_cursor = 0;
+            const auto new_epoch = next_epoch(epoch);
             if (!try_update_epoch(epoch, new_epoch))
-                return;
+                return false;
 
             epoch = new_epoch;
         }
         else
-            return;
+        {
+            if (!ready_list.empty())
+                reclaim_ready_objects(false);
+            return true;
+        }
+
+        // the deferred callbacks belong to the epoch we are leaving
+        if (deferred != nullptr)
+            retire_deferred();
 
         // we either just updated the global_epoch or we are observing a new epoch from some other thread
         // either way - we can reclaim all the objects from the old 'incarnation' of this epoch
 
-        control_block->local_epoch.store(epoch, std::memory_order_relaxed);
-        utils::delete_objects(retire_lists[epoch]);
+        local_epoch = epoch;
+        control_block->publish_hint(thread_control_block::announce(epoch, true));
+        control_block->announcement().store(thread_control_block::announce(epoch, true), std::memory_order_relaxed);
+#ifdef EPOCH_BASED_MONOTONIC_EPOCHS
+        // The new announcement has to be visible before we rely on it, otherwise the epoch could
+        // advance twice while others still see our previous one.
+        for (;;)
+        {
+#ifdef EPOCH_BASED_ASYMMETRIC_FENCE
+            // (14) - this light fence pairs with the heavy fence (8)
+            utils::asymmetric_fence::light();
+#else
+            // (14) - this seq_cst-fence enforces a total order with itself and the seq_cst-fence (3)
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+#endif
+            // (15) - this acquire-load synchronizes-with the release-CAS (7)
+            epoch = global_epoch.load(std::memory_order_acquire);
+            if (epoch == local_epoch)
+                break;
+            local_epoch = epoch;
+            control_block->publish_hint(thread_control_block::announce(epoch, true));
+            control_block->announcement().store(thread_control_block::announce(epoch, true), std::memory_order_relaxed);
+        }
+        reclaim_expired_lists(force_update);
+#else
+        reclaim_retire_list(retire_lists[epoch], retired_objects[epoch], retired_bytes[epoch], force_update);
+#endif
+        return true;
     }
 
-    void do_leave_critical() {
-        // (5) - this release-store synchronizes-with the acquire-fence (6)
-        control_block->is_in_critical_region.store(false, std::memory_order_release);
+    bool should_try_update(epoch_t epoch) {
+        const auto step = retirement.advance_step.load(std::memory_order_relaxed);
+        if (step == 0)
+            return entries_since_update++ == UpdateThreshold;
+
+        // The cursor only decides when an update is worth trying; its observations may be outdated
+        // by the time it reaches the end, so try_update_epoch still performs the full check.
+        const auto blocking = thread_control_block::announce(previous_epoch(epoch), true);
+        const auto slots = global_thread_block_list.slot_count();
+        for (std::size_t i = 0; i < step && scan_cursor < slots; ++i)
+        {
+            auto word = global_thread_block_list.announcement_at(scan_cursor);
+            if (word != nullptr && word->load(std::memory_order_relaxed) == blocking)
+            {
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+                // waiting at a blocker counts as failed update, so that it eventually gets ejected
+                record_update_result(false);
+                return fallback_triggered();
+#else
+                return false;
+#endif
+            }
+            ++scan_cursor;
+        }
+        return scan_cursor >= slots;
     }
 
-    void add_retired_node(utils::deletable_object* p, size_t epoch) {
-        assert(epoch < number_epochs);
-        p->next = retire_lists[epoch];
-        retire_lists[epoch] = p;
+#ifdef EPOCH_BASED_MONOTONIC_EPOCHS
+    // A thread that announces epoch e may still hold references to objects retired in epoch e - 1,
+    // but not to older ones, so everything retired at least two epochs before the oldest announced
+    // epoch has expired.
+    void reclaim_expired_lists(bool ignore_budget) {
+        utils::retire_list expired;
+        std::size_t objects = 0;
+        std::size_t bytes = 0;
+        epoch_t newest = 0;
+        const bool may_expire = !retire_lists.empty() && retire_lists.front().epoch + 2 <= local_epoch;
+        const auto horizon = may_expire ? reclaim_horizon() : 0;
+        while (may_expire && !retire_lists.empty() && retire_lists.front().epoch + 2 <= horizon)
+        {
+            auto& list = retire_lists.front();
+            expired.append(list.nodes);
+            objects += list.objects;
+            bytes += list.bytes;
+            newest = list.epoch;
+            retire_lists.pop_front();
+        }
+
+        // also continues with the ready list if there is a reclamation budget
+        reclaim_retire_list(expired, objects, bytes, ignore_budget);
+        if (!expired.empty())
+        {
+            // objects kept by hazards
+            retire_lists.emplace_front(newest);
+            retire_lists.front().nodes.append(expired);
+            retire_lists.front().objects = objects;
+            retire_lists.front().bytes = bytes;
+        }
     }
 
-    bool try_update_epoch(unsigned curr_epoch, unsigned new_epoch) {
-        const auto old_epoch = (curr_epoch + number_epochs - 1) % number_epochs;
-        auto prevents_update = [old_epoch](const thread_control_block& data)
+    // The oldest epoch a thread in its critical region may be working in. This is our (just validated)
+    // local epoch unless some thread still announces the previous one. Announcements that lag further
+    // behind have not been validated yet; such threads announce a newer epoch before accessing any
+    // object. With asymmetric fences the announcements are not scanned, as that would need a heavy
+    // fence per epoch change and thread, and the horizon conservatively is the previous epoch.
+    epoch_t reclaim_horizon() const {
+#ifdef EPOCH_BASED_ASYMMETRIC_FENCE
+        return previous_epoch(local_epoch);
+#else
+        // TSan does not support explicit fences, so we have to use acquire-loads (see try_update_epoch).
+        constexpr auto memory_order = TSAN_MEMORY_ORDER(std::memory_order_acquire, std::memory_order_relaxed);
+        const auto slots = global_thread_block_list.slot_count();
+        auto horizon = local_epoch;
+        for (std::uint32_t i = 0; i < slots; ++i)
         {
-            // TSan does not support explicit fences, so we cannot rely on the acquire-fence (6)
-            // but have to perform an acquire-load here to avoid false positives.
-            constexpr auto memory_order = TSAN_MEMORY_ORDER(std::memory_order_acquire, std::memory_order_relaxed);
-            return data.is_in_critical_region.load(memory_order) &&
-                         data.local_epoch.load(std::memory_order_relaxed) == old_epoch;
+            auto word = global_thread_block_list.announcement_at(i);
+            if (word == nullptr)
+                continue;
+            const auto announcement = word->load(memory_order);
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+            if (announcement == thread_control_block::ejected)
+                continue;
+#endif
+            if ((announcement & 1) != 0 && thread_control_block::lag(announcement, local_epoch) == 1)
+            {
+                horizon = previous_epoch(local_epoch);
+                break;
+            }
+        }
+        // (16) - this acquire-fence synchronizes-with the release-store (5)
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return horizon;
+#endif
+    }
+#endif
+
+    void reclaim_retire_list(utils::retire_list& list, std::size_t& objects, std::size_t& bytes, bool ignore_budget) {
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+        // objects guarded by ejected threads stay in the list for another round
+        utils::retire_list hazardous;
+        std::size_t hazardous_objects = 0;
+        std::size_t hazardous_bytes = 0;
+        retain_hazardous_objects(list, objects, bytes, hazardous, hazardous_objects, hazardous_bytes);
+        reclaim_expired_list(list, objects, bytes, ignore_budget);
+        list.append(hazardous);
+        objects += hazardous_objects;
+        bytes += hazardous_bytes;
+#else
+        reclaim_expired_list(list, objects, bytes, ignore_budget);
+#endif
+    }
+
+    void reclaim_expired_list(utils::retire_list& list, std::size_t& objects, std::size_t& bytes, bool ignore_budget) {
+        if (!list.empty() && reclamation_service.is_running())
+        {
+            auto chunks = list.release();
+#ifdef EPOCH_BASED_TRACING
+            const auto now = utils::trace_clock();
+            for (auto c = chunks.first; c != nullptr; c = c->next)
+                control_block->trace.record_age(c->retired_at, now, c->count);
+            trace(utils::trace_event_kind::handover, local_epoch, objects, now);
+#endif
+            reclamation_service.submit(chunks.first, chunks.second);
+            chunk_pool.put_all(reclamation_service.take_free_chunks());
+        }
+        else if (has_reclamation_budget() || !ready_list.empty())
+        {
+            // move the expired list to the end of the ready list to retain the retire order
+            ready_list.append(list);
+            ready_objects += objects;
+            ready_bytes += bytes;
+            objects = 0;
+            bytes = 0;
+            reclaim_ready_objects(ignore_budget);
+            return;
+        }
+        else
+        {
+#ifdef EPOCH_BASED_TRACING
+            const auto start = utils::trace_clock();
+            for (auto c = list.front(); c != nullptr; c = c->next)
+                control_block->trace.record_age(c->retired_at, start, c->count);
+#endif
+            list.delete_objects(&chunk_pool);
+#ifdef EPOCH_BASED_TRACING
+            if (objects != 0)
+                trace(utils::trace_event_kind::reclamation, local_epoch, objects, start, utils::trace_clock() - start);
+#endif
+        }
+
+        thread_control_block::add(control_block->stats.reclaimed_objects, objects);
+        thread_control_block::add(control_block->stats.reclaimed_bytes, bytes);
+        unpublished_objects -= objects;
+        unpublished_bytes -= bytes;
+        objects = 0;
+        bytes = 0;
+        publish_pending();
+    }
+
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+    bool is_ejected() const {
+        return control_block->announcement().load(std::memory_order_relaxed) == thread_control_block::ejected;
+    }
+
+    // Moves the objects of the given retire list that are in any thread's hazard slot to hazardous.
+    // Only necessary once a thread has been ejected; the hazards of all other threads point to
+    // objects that have not been retired long enough, so they simply cause no match.
+    void retain_hazardous_objects(utils::retire_list& list, std::size_t& objects, std::size_t& bytes,
+                                  utils::retire_list& hazardous, std::size_t& hazardous_objects, std::size_t& hazardous_bytes) {
+        if (list.empty() || retirement.ejections.load(std::memory_order_relaxed) == 0)
+            return;
+
+        // (11) - this seq_cst-fence enforces a total order with the seq_cst-fence (10)
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        hazard_buffer.clear();
+        for (auto& entry : global_thread_block_list)
+            for (auto& hazard : entry.hazards)
+                if (auto p = hazard.load(std::memory_order_acquire))
+                    hazard_buffer.push_back(p);
+        if (hazard_buffer.empty())
+            return;
+        std::sort(hazard_buffer.begin(), hazard_buffer.end());
+
+        const std::size_t bytes_per_object = objects != 0 ? bytes / objects : 0;
+        utils::retire_list candidates;
+        candidates.append(list);
+        for (auto p = candidates.pop(chunk_pool); p.first != nullptr; p = candidates.pop(chunk_pool))
+        {
+            if (std::binary_search(hazard_buffer.begin(), hazard_buffer.end(), p.first))
+            {
+                hazardous.push(p.first, p.second, chunk_pool);
+                ++hazardous_objects;
+            }
+            else
+                list.push(p.first, p.second, chunk_pool);
+        }
+        hazardous_bytes = std::min(bytes, hazardous_objects * bytes_per_object);
+        objects -= hazardous_objects;
+        bytes -= hazardous_bytes;
+    }
+
+    // The objects retired while we were ejected are handed over like the retire lists of an exiting
+    // thread, so they are reclaimed after two further epoch updates.
+    void abandon_ejected_list() {
+#ifdef EPOCH_BASED_MONOTONIC_EPOCHS
+        // they were retired no later than in the current epoch
+        auto target_epoch = global_epoch.load(std::memory_order_relaxed);
+#else
+        auto target_epoch = previous_epoch(global_epoch.load(std::memory_order_relaxed));
+#endif
+        global_thread_block_list.abandon_retired_nodes(new utils::orphan(target_epoch, ejected_list,
+            ejected_objects, ejected_bytes));
+        thread_control_block::add(control_block->stats.orphans_created, 1);
+        ejected_objects = 0;
+        ejected_bytes = 0;
+    }
+
+    // Ejects the threads whose announcement equals blocking if the fallback has been triggered.
+    // Returns a thread that still prevents the epoch update, or nullptr.
+    thread_control_block* eject_blocking_threads(unsigned blocking, std::memory_order order) {
+        bool ejected_any = false;
+        while (auto blocker = global_thread_block_list.find_announcement(blocking, order))
+        {
+            if (!fallback_triggered())
+                return blocker;
+
+            auto expected = blocking;
+            if (blocker->announcement().compare_exchange_strong(expected, thread_control_block::ejected,
+                    std::memory_order_relaxed))
+            {
+                retirement.ejections.fetch_add(1, std::memory_order_relaxed);
+                ejected_any = true;
+            }
+        }
+
+        if (auto blocker = global_thread_block_list.find_announcement(blocking, blocking | thread_control_block::pinned, order))
+            return blocker;
+
+        if (ejected_any)
+        {
+            // (13) - this heavy fence makes the hazards of all ejected threads that passed their
+            //        light fence (12) visible before they get checked
+            utils::asymmetric_fence::heavy();
+        }
+        return nullptr;
+    }
+
+    static bool fallback_triggered() {
+        const auto max_failed = retirement.eject_after_failed_updates.load(std::memory_order_relaxed);
+        if (max_failed != 0 && retirement.failed_updates.load(std::memory_order_relaxed) >= max_failed)
+            return true;
+
+        const auto max_time = retirement.eject_after_blocked_time.load(std::memory_order_relaxed);
+        const auto since = retirement.blocked_since.load(std::memory_order_relaxed);
+        return max_time != 0 && since != 0 && now() - since >= max_time;
+    }
+
+    static void record_update_result(bool success) {
+        if (success)
+        {
+            if (retirement.failed_updates.load(std::memory_order_relaxed) != 0)
+            {
+                retirement.failed_updates.store(0, std::memory_order_relaxed);
+                retirement.blocked_since.store(0, std::memory_order_relaxed);
+            }
+            return;
+        }
+
+        retirement.failed_updates.fetch_add(1, std::memory_order_relaxed);
+        if (retirement.eject_after_blocked_time.load(std::memory_order_relaxed) != 0 &&
+            retirement.blocked_since.load(std::memory_order_relaxed) == 0)
+        {
+            std::chrono::nanoseconds::rep expected = 0;
+            retirement.blocked_since.compare_exchange_strong(expected, now(), std::memory_order_relaxed);
+        }
+    }
+
+    static std::chrono::nanoseconds::rep now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+#endif
+
+    static bool has_reclamation_budget() {
+        return retirement.budget_objects.load(std::memory_order_relaxed) != 0 ||
+               retirement.budget_time.load(std::memory_order_relaxed) != 0;
+    }
+
+    // Deletes objects from the head of the ready list until it is empty or the budget is exhausted.
+    void reclaim_ready_objects(bool ignore_budget) {
+        std::size_t max_objects = ignore_budget ? 0 : retirement.budget_objects.load(std::memory_order_relaxed);
+        auto max_time = ignore_budget ? 0 : retirement.budget_time.load(std::memory_order_relaxed);
+        if (max_objects == 0)
+            max_objects = std::numeric_limits<std::size_t>::max();
+
+        using clock = std::chrono::steady_clock;
+        const auto start = max_time != 0 ? clock::now() : clock::time_point();
+        constexpr std::size_t time_check_interval = 8;
+
+        // the sizes of individual objects are not known, so the bytes are released proportionally
+        const std::size_t bytes_per_object = ready_objects != 0 ? ready_bytes / ready_objects : 0;
+
+        std::size_t count = 0;
+#ifdef EPOCH_BASED_TRACING
+        const auto trace_start = utils::trace_clock();
+        utils::age_run ages(control_block->trace);
+#endif
+        while (count < max_objects)
+        {
+#ifdef EPOCH_BASED_TRACING
+            if (ready_list.empty())
+                break;
+            ages.add(ready_list.front()->retired_at);
+#endif
+            // remove the object before deleting it, as its destructor may retire further objects
+            auto p = ready_list.pop(chunk_pool);
+            if (p.first == nullptr)
+                break;
+            --ready_objects;
+            ++count;
+            p.second(&p.first, 1);
+            if (max_time != 0 && count % time_check_interval == 0 &&
+                clock::now() - start >= std::chrono::nanoseconds(max_time))
+                break;
+        }
+
+#ifdef EPOCH_BASED_TRACING
+        ages.flush();
+        if (count != 0)
+            trace(utils::trace_event_kind::reclamation, local_epoch, count, trace_start, utils::trace_clock() - trace_start);
+#endif
+
+        const std::size_t bytes = ready_list.empty() ? ready_bytes : std::min(ready_bytes, bytes_per_object * count);
+        ready_bytes -= bytes;
+        thread_control_block::add(control_block->stats.reclaimed_objects, count);
+        thread_control_block::add(control_block->stats.reclaimed_bytes, bytes);
+        unpublished_objects -= count;
+        unpublished_bytes -= bytes;
+        publish_pending();
+    }
+
+    void do_leave_critical() {
+        // (5) - this release-store synchronizes-with the acquire-fences (6, 16)
+        control_block->announcement().store(thread_control_block::announce(local_epoch, false), std::memory_order_release);
+    }
+
+    void retire_deferred() {
+        auto chunk = deferred;
+        deferred = nullptr;
+        add_retired_node(chunk, &utils::deferred_chunk::reclaim, sizeof(utils::deferred_chunk));
+    }
+
+    // Passes through an empty critical region. Returns false if an epoch update was attempted but
+    // some other thread prevented it.
+    bool enter_and_leave(bool force_update) {
+        ++enter_count;
+        const bool result = do_enter_critical(force_update);
+        --enter_count;
+        do_leave_critical();
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+        if (!ejected_list.empty())
+            abandon_ejected_list();
+#endif
+        return result;
+    }
+
+    std::size_t thread_pending_objects() const {
+        std::size_t result = ready_objects;
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+        result += ejected_objects;
+#endif
+#ifdef EPOCH_BASED_MONOTONIC_EPOCHS
+        for (auto& list : retire_lists)
+            result += list.objects;
+        return result;
+#else
+        return std::accumulate(retired_objects.begin(), retired_objects.end(), result);
+#endif
+    }
+
+    std::size_t thread_pending_bytes() const {
+        std::size_t result = ready_bytes;
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+        result += ejected_bytes;
+#endif
+#ifdef EPOCH_BASED_MONOTONIC_EPOCHS
+        for (auto& list : retire_lists)
+            result += list.bytes;
+        return result;
+#else
+        return std::accumulate(retired_bytes.begin(), retired_bytes.end(), result);
+#endif
+    }
+
+    bool reached_retire_limits() const {
+        auto reached = [](std::size_t value, const std::atomic<std::size_t>& limit) {
+            auto l = limit.load(std::memory_order_relaxed);
+            return l != 0 && value >= l;
         };
+        return reached(thread_pending_objects(), retirement.thread_objects_limit) ||
+               reached(thread_pending_bytes(), retirement.thread_bytes_limit) ||
+               reached(retirement.pending_objects.load(std::memory_order_relaxed), retirement.global_objects_limit) ||
+               reached(retirement.pending_bytes.load(std::memory_order_relaxed), retirement.global_bytes_limit);
+    }
+
+    // Called outside of any critical region once a retire limit has been reached. Every round enters
+    // the critical region with a forced epoch update, so after number_epochs successful rounds all of
+    // this thread's retire lists have been reclaimed.
+    void force_reclaim() {
+        limit_reached = false;
+        publish_pending();
+
+        bool blocked = false;
+        for (unsigned i = 0; i < number_epochs && !blocked && reached_retire_limits(); ++i)
+            blocked = !enter_and_leave(true);
+        while (!ready_list.empty())
+            reclaim_ready_objects(true);
+
+        if (!reached_retire_limits())
+            return;
+
+        auto handler = retirement.handler.load(std::memory_order_relaxed);
+        if (handler)
+            handler(retire_limit_report{thread_pending_objects(), thread_pending_bytes(),
+                retirement.pending_objects.load(std::memory_order_relaxed),
+                retirement.pending_bytes.load(std::memory_order_relaxed),
+                blocked});
+    }
+
+    void publish_pending() {
+        if (unpublished_objects != 0)
+            retirement.pending_objects.fetch_add(unpublished_objects, std::memory_order_relaxed);
+        if (unpublished_bytes != 0)
+            retirement.pending_bytes.fetch_add(unpublished_bytes, std::memory_order_relaxed);
+        unpublished_objects = 0;
+        unpublished_bytes = 0;
+        if (control_block != nullptr)
+            publish_pending_statistics();
+    }
+
+    void publish_pending_statistics() {
+        std::array<std::size_t, number_epochs> pending = {};
+#ifdef EPOCH_BASED_MONOTONIC_EPOCHS
+        for (auto& list : retire_lists)
+            pending[list.epoch % number_epochs] += list.objects;
+#else
+        pending = retired_objects;
+#endif
+        auto& stats = control_block->stats;
+        for (unsigned i = 0; i < number_epochs; ++i)
+            stats.pending_objects[i].store(pending[i], std::memory_order_relaxed);
+        stats.ready_objects.store(ready_objects, std::memory_order_relaxed);
+    }
+
+    bool try_update_epoch(epoch_t curr_epoch, epoch_t new_epoch) {
+        const auto old_epoch = previous_epoch(curr_epoch);
+        const auto blocking = thread_control_block::announce(old_epoch, true);
+
+#ifdef EPOCH_BASED_ASYMMETRIC_FENCE
+        // (8) - this heavy fence makes the announcements of all readers that passed their light fences (3, 14)
+        //       visible before we scan them
+        utils::asymmetric_fence::heavy();
+#endif
 
         // If any thread hasn't advanced to the current epoch, abort the attempt.
-        auto can_update = !std::any_of(global_thread_block_list.begin(), global_thread_block_list.end(), prevents_update);
-        if (!can_update)
+        // TSan does not support explicit fences, so we cannot rely on the acquire-fence (6)
+        // but have to perform acquire-loads here to avoid false positives.
+        constexpr auto memory_order = TSAN_MEMORY_ORDER(std::memory_order_acquire, std::memory_order_relaxed);
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+        if (auto blocker = eject_blocking_threads(blocking, memory_order))
+        {
+            record_update_result(false);
+            record_blocker(*blocker);
             return false;
+        }
+#else
+        if (auto blocker = global_thread_block_list.find_announcement(blocking, memory_order))
+        {
+            record_blocker(*blocker);
+            return false;
+        }
+#endif
 
         if (global_epoch.load(std::memory_order_relaxed) == curr_epoch)
         {
@@ -312,56 +1586,365 @@ private:
             // (7) - this release-CAS synchronizes-with the acquire-load (4)
             bool success = global_epoch.compare_exchange_strong(curr_epoch, new_epoch, std::memory_order_release, std::memory_order_relaxed);
             if (success)
+            {
+                thread_control_block::add(control_block->stats.epoch_advances, 1);
+#ifdef EPOCH_BASED_TRACING
+                trace(utils::trace_event_kind::epoch_advance, new_epoch, 0);
+#endif
+                if (retirement.streak_length.load(std::memory_order_relaxed) != 0)
+                    retirement.streak_length.store(0, std::memory_order_relaxed);
                 adopt_orphans();
+            }
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+            if (success)
+                record_update_result(true);
+#endif
         }
 
         // return true regardless of whether the CAS operation was successful or not, as it is not necessary to be successful
         return true;
     }
 
+    void record_blocker(thread_control_block& blocker) {
+        thread_control_block::add(control_block->stats.failed_advances, 1);
+        control_block->stats.last_blocker.store(blocker.slot(), std::memory_order_relaxed);
+        blocker.stats.blocked_advances.fetch_add(1, std::memory_order_relaxed);
+#ifdef EPOCH_BASED_TRACING
+        trace(utils::trace_event_kind::failed_advance, local_epoch, blocker.slot());
+#endif
+
+        auto handler = retirement.stall_callback.load(std::memory_order_relaxed);
+        if (handler == nullptr)
+            return;
+
+        // concurrent updaters may lose some increments, which only delays the report
+        std::size_t streak = 1;
+        if (retirement.streak_thread.load(std::memory_order_relaxed) == blocker.slot())
+            streak = retirement.streak_length.load(std::memory_order_relaxed) + 1;
+        else
+            retirement.streak_thread.store(blocker.slot(), std::memory_order_relaxed);
+        retirement.streak_length.store(streak, std::memory_order_relaxed);
+
+        const auto repeats = retirement.stall_repeats.load(std::memory_order_relaxed);
+        if (repeats != 0 && streak % repeats == 0)
+            handler(describe_stall(blocker));
+    }
+
+    static stalled_thread describe_stall(const thread_control_block& blocker) {
+        const auto entered_at = blocker.entered_at.load(std::memory_order_relaxed);
+        return stalled_thread{blocker.slot(), blocker.get_label(),
+            std::chrono::nanoseconds(entered_at != 0 ? thread_control_block::now() - entered_at : 0),
+            blocker.stats.blocked_advances.load(std::memory_order_relaxed)};
+    }
+
     void adopt_orphans() {
         auto current = global_thread_block_list.adopt_abandoned_retired_nodes();
-        for (utils::deletable_object* next = nullptr; current != nullptr; current = next)
+#ifdef EPOCH_BASED_TRACING
+        std::size_t adopted_objects = 0;
+#endif
+        for (utils::orphan* next = nullptr; current != nullptr; current = next)
         {
             next = current->next;
-            current->next = nullptr;
-            add_retired_node(current, static_cast<utils::orphan<number_epochs>*>(current)->target_epoch);
+            auto orphan = current;
+            const epoch_t epoch = orphan->target_epoch;
+#ifdef EPOCH_BASED_MONOTONIC_EPOCHS
+            // merge into the oldest list that is not older, so that nothing expires early
+            auto it = std::find_if(retire_lists.begin(), retire_lists.end(),
+                [epoch](const stamped_list& list) { return list.epoch >= epoch; });
+            if (it == retire_lists.end())
+            {
+                retire_lists.emplace_back(epoch);
+                it = std::prev(retire_lists.end());
+            }
+            it->nodes.append(orphan->nodes);
+            it->objects += orphan->retired_objects;
+            it->bytes += orphan->retired_bytes;
+#else
+            retire_lists[epoch].append(orphan->nodes);
+            retired_objects[epoch] += orphan->retired_objects;
+            retired_bytes[epoch] += orphan->retired_bytes;
+#endif
+            thread_control_block::add(control_block->stats.orphans_adopted, 1);
+#ifdef EPOCH_BASED_TRACING
+            adopted_objects += orphan->retired_objects;
+#endif
+            delete orphan;
         }
+#ifdef EPOCH_BASED_TRACING
+        if (adopted_objects != 0)
+            trace(utils::trace_event_kind::orphan_adoption, local_epoch, adopted_objects);
+#endif
     }
 
+#ifdef EPOCH_BASED_TRACING
+    void trace(utils::trace_event_kind kind, epoch_t epoch, std::uint64_t value,
+               std::int64_t start = utils::trace_clock(), std::int64_t duration = 0) {
+        control_block->trace.record(utils::trace_event{start, duration, kind, epoch, value});
+    }
+#endif
+
+    // Retired counts are published to the global counters in batches of this size.
+    static constexpr std::size_t publish_interval = 64;
+
     unsigned enter_count = 0;
     unsigned entries_since_update = 0;
+    // next announcement slot to check if the epoch advance step is set
+    std::uint32_t scan_cursor = 0;
+    epoch_t local_epoch = number_epochs;
+    bool limit_reached = false;
     thread_control_block* control_block = nullptr;
-    std::array<utils::deletable_object*, number_epochs> retire_lists = {};
+    utils::chunk_pool chunk_pool;
+    // callbacks deferred in local_epoch that have not been retired yet
+    utils::deferred_chunk* deferred = nullptr;
+#ifdef EPOCH_BASED_MONOTONIC_EPOCHS
+    struct stamped_list {
+        explicit stamped_list(epoch_t epoch) : epoch(epoch) {}
+        epoch_t epoch;
+        utils::retire_list nodes;
+        std::size_t objects = 0;
+        std::size_t bytes = 0;
+    };
+    // ordered by epoch, oldest first
+    std::deque<stamped_list> retire_lists;
+#else
+    std::array<utils::retire_list, number_epochs> retire_lists;
+    std::array<std::size_t, number_epochs> retired_objects = {};
+    std::array<std::size_t, number_epochs> retired_bytes = {};
+#endif
+    // expired objects waiting to be deleted under the reclamation budget
+    utils::retire_list ready_list;
+    std::size_t ready_objects = 0;
+    std::size_t ready_bytes = 0;
+    // pending counts not yet added to the global counters; the unsigned arithmetic wraps around
+    // to represent negative deltas
+    std::size_t unpublished_objects = 0;
+    std::size_t unpublished_bytes = 0;
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+    unsigned free_hazard_slots = (1u << thread_control_block::hazard_slots) - 1;
+    unsigned pin_count = 0;
+    // objects retired while ejected
+    utils::retire_list ejected_list;
+    std::size_t ejected_objects = 0;
+    std::size_t ejected_bytes = 0;
+    std::vector<void*> hazard_buffer;
+#endif
 
     friend class epoch_based;
     ALLOCATION_COUNTER(epoch_based);
 };
 
 //GLOBALS
-template <std::size_t UpdateThreshold>
-std::atomic<unsigned> epoch_based<UpdateThreshold>::global_epoch;
+template <std::size_t UpdateThreshold, class Domain>
+std::atomic<typename epoch_based<UpdateThreshold, Domain>::epoch_t> epoch_based<UpdateThreshold, Domain>::global_epoch;
+
+template <std::size_t UpdateThreshold, class Domain>
+typename epoch_based<UpdateThreshold, Domain>::retirement_state epoch_based<UpdateThreshold, Domain>::retirement;
+
+template <std::size_t UpdateThreshold, class Domain>
+utils::reclamation_service epoch_based<UpdateThreshold, Domain>::reclamation_service;
 
-template <std::size_t UpdateThreshold>
-utils::thread_block_list<typename epoch_based<UpdateThreshold>::thread_control_block>
-    epoch_based<UpdateThreshold>::global_thread_block_list;
+template <std::size_t UpdateThreshold, class Domain>
+utils::thread_block_list<typename epoch_based<UpdateThreshold, Domain>::thread_control_block, utils::orphan>
+    epoch_based<UpdateThreshold, Domain>::global_thread_block_list;
 
-template <std::size_t UpdateThreshold>
-inline typename epoch_based<UpdateThreshold>::thread_data& epoch_based<UpdateThreshold>::local_thread_data() {
+template <std::size_t UpdateThreshold, class Domain>
+inline typename epoch_based<UpdateThreshold, Domain>::thread_data& epoch_based<UpdateThreshold, Domain>::local_thread_data() {
     static thread_local thread_data local_thread_data;
     return local_thread_data;
 }
 
+template <std::size_t UpdateThreshold, class Domain>
+void epoch_based<UpdateThreshold, Domain>::set_retire_limits(const retire_limits& limits) {
+    retirement.thread_objects_limit.store(limits.thread_objects, std::memory_order_relaxed);
+    retirement.thread_bytes_limit.store(limits.thread_bytes, std::memory_order_relaxed);
+    retirement.global_objects_limit.store(limits.global_objects, std::memory_order_relaxed);
+    retirement.global_bytes_limit.store(limits.global_bytes, std::memory_order_relaxed);
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+auto epoch_based<UpdateThreshold, Domain>::get_retire_limits() -> retire_limits {
+    retire_limits result;
+    result.thread_objects = retirement.thread_objects_limit.load(std::memory_order_relaxed);
+    result.thread_bytes = retirement.thread_bytes_limit.load(std::memory_order_relaxed);
+    result.global_objects = retirement.global_objects_limit.load(std::memory_order_relaxed);
+    result.global_bytes = retirement.global_bytes_limit.load(std::memory_order_relaxed);
+    return result;
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+void epoch_based<UpdateThreshold, Domain>::set_retire_limit_handler(retire_limit_handler handler) {
+    retirement.handler.store(handler, std::memory_order_relaxed);
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+std::pair<std::size_t, std::size_t> epoch_based<UpdateThreshold, Domain>::pending_retired() {
+    return std::make_pair(retirement.pending_objects.load(std::memory_order_relaxed),
+                          retirement.pending_bytes.load(std::memory_order_relaxed));
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+void epoch_based<UpdateThreshold, Domain>::start_reclamation_service(unsigned threads) {
+    reclamation_service.start(threads);
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+void epoch_based<UpdateThreshold, Domain>::stop_reclamation_service() {
+    reclamation_service.stop();
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+auto epoch_based<UpdateThreshold, Domain>::get_thread_context() -> thread_context {
+    return thread_context(local_thread_data());
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+void epoch_based<UpdateThreshold, Domain>::synchronize() {
+    local_thread_data().synchronize();
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+void epoch_based<UpdateThreshold, Domain>::flush() {
+    local_thread_data().flush();
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+template <class F>
+void epoch_based<UpdateThreshold, Domain>::defer(F&& f) {
+    local_thread_data().defer(std::forward<F>(f));
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+void epoch_based<UpdateThreshold, Domain>::set_reclamation_budget(std::size_t max_objects, std::chrono::nanoseconds max_time) {
+    retirement.budget_objects.store(max_objects, std::memory_order_relaxed);
+    retirement.budget_time.store(max_time.count(), std::memory_order_relaxed);
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+auto epoch_based<UpdateThreshold, Domain>::snapshot() -> statistics {
+    statistics result;
+    result.global_epoch = global_epoch.load(std::memory_order_relaxed);
+    auto& total = result.total;
+    for (auto& entry : global_thread_block_list)
+    {
+        const auto& stats = entry.stats;
+        thread_statistics t;
+        t.thread = entry.slot();
+        t.registered = entry.is_active();
+        t.in_critical_region = entry.is_in_critical_region();
+        t.epoch_advances = stats.epoch_advances.load(std::memory_order_relaxed);
+        t.failed_advances = stats.failed_advances.load(std::memory_order_relaxed);
+        t.blocked_advances = stats.blocked_advances.load(std::memory_order_relaxed);
+        t.last_blocker = stats.last_blocker.load(std::memory_order_relaxed);
+        t.retired_objects = stats.retired_objects.load(std::memory_order_relaxed);
+        t.retired_bytes = stats.retired_bytes.load(std::memory_order_relaxed);
+        t.reclaimed_objects = stats.reclaimed_objects.load(std::memory_order_relaxed);
+        t.reclaimed_bytes = stats.reclaimed_bytes.load(std::memory_order_relaxed);
+        t.orphans_created = stats.orphans_created.load(std::memory_order_relaxed);
+        t.orphans_adopted = stats.orphans_adopted.load(std::memory_order_relaxed);
+        for (unsigned i = 0; i < number_epochs; ++i)
+            t.pending_objects[i] = stats.pending_objects[i].load(std::memory_order_relaxed);
+        t.ready_objects = stats.ready_objects.load(std::memory_order_relaxed);
+
+        total.epoch_advances += t.epoch_advances;
+        total.failed_advances += t.failed_advances;
+        total.blocked_advances += t.blocked_advances;
+        total.retired_objects += t.retired_objects;
+        total.retired_bytes += t.retired_bytes;
+        total.reclaimed_objects += t.reclaimed_objects;
+        total.reclaimed_bytes += t.reclaimed_bytes;
+        total.orphans_created += t.orphans_created;
+        total.orphans_adopted += t.orphans_adopted;
+        for (unsigned i = 0; i < number_epochs; ++i)
+            total.pending_objects[i] += t.pending_objects[i];
+        total.ready_objects += t.ready_objects;
+        result.threads.push_back(t);
+    }
+    return result;
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+void epoch_based<UpdateThreshold, Domain>::set_thread_label(const char* label) {
+    local_thread_data().set_label(label);
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+void epoch_based<UpdateThreshold, Domain>::set_stall_detection(bool enabled) {
+    retirement.stall_detection.store(enabled, std::memory_order_relaxed);
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+auto epoch_based<UpdateThreshold, Domain>::stalled_threads(std::chrono::nanoseconds min_duration) -> std::vector<stalled_thread> {
+    const auto blocking = thread_control_block::announce(previous_epoch(global_epoch.load(std::memory_order_relaxed)), true);
+    std::vector<stalled_thread> result;
+    for (auto& entry : global_thread_block_list)
+    {
+        auto announcement = entry.announcement().load(std::memory_order_relaxed);
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+        announcement &= ~thread_control_block::pinned;
+#endif
+        if (announcement != blocking)
+            continue;
+
+        auto stall = thread_data::describe_stall(entry);
+        if (stall.in_critical_region >= min_duration)
+            result.push_back(std::move(stall));
+    }
+    return result;
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+void epoch_based<UpdateThreshold, Domain>::set_stall_handler(stall_handler handler, std::size_t repeated_blocks) {
+    retirement.stall_repeats.store(repeated_blocks, std::memory_order_relaxed);
+    retirement.stall_callback.store(handler, std::memory_order_relaxed);
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+void epoch_based<UpdateThreshold, Domain>::set_epoch_advance_step(std::size_t threads_per_entry) {
+    retirement.advance_step.store(threads_per_entry, std::memory_order_relaxed);
+}
+
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+template <std::size_t UpdateThreshold, class Domain>
+void epoch_based<UpdateThreshold, Domain>::set_hazard_fallback(std::size_t max_failed_updates, std::chrono::nanoseconds max_blocked_time) {
+    retirement.eject_after_failed_updates.store(max_failed_updates, std::memory_order_relaxed);
+    retirement.eject_after_blocked_time.store(max_blocked_time.count(), std::memory_order_relaxed);
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+std::size_t epoch_based<UpdateThreshold, Domain>::ejected_readers() {
+    return retirement.ejections.load(std::memory_order_relaxed);
+}
+#endif
+
+#ifdef EPOCH_BASED_TRACING
+template <std::size_t UpdateThreshold, class Domain>
+utils::age_histogram epoch_based<UpdateThreshold, Domain>::retire_ages() {
+    utils::age_histogram result;
+    for (auto& entry : global_thread_block_list)
+        result.merge(entry.trace.get_ages());
+    return result;
+}
+
+template <std::size_t UpdateThreshold, class Domain>
+void epoch_based<UpdateThreshold, Domain>::write_chrome_trace(std::ostream& out) {
+    out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+    bool first = true;
+    for (auto& entry : global_thread_block_list)
+        utils::write_chrome_trace_events(out, entry.slot(), entry.get_label(), entry.trace.get_events(), first);
+    out << "\n]}\n";
+}
+#endif
+
 #ifdef TRACK_ALLOCATIONS
-template <std::size_t UpdateThreshold>
-utils::allocation_tracker epoch_based<UpdateThreshold>::allocation_tracker;
+template <std::size_t UpdateThreshold, class Domain>
+utils::allocation_tracker epoch_based<UpdateThreshold, Domain>::allocation_tracker;
 
-template <std::size_t UpdateThreshold>
-inline void epoch_based<UpdateThreshold>::count_allocation()
+template <std::size_t UpdateThreshold, class Domain>
+inline void epoch_based<UpdateThreshold, Domain>::count_allocation()
 { local_thread_data().allocation_counter.count_allocation(); }
 
-template <std::size_t UpdateThreshold>
-inline void epoch_based<UpdateThreshold>::count_reclamation()
+template <std::size_t UpdateThreshold, class Domain>
+inline void epoch_based<UpdateThreshold, Domain>::count_reclamation()
 { local_thread_data().allocation_counter.count_reclamation(); }
 #endif
 }}
@@ -0,0 +1,68 @@
+#ifndef _FIND_WORD_
+#define _FIND_WORD_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "port.hpp"
+
+#if !defined(__SANITIZE_THREAD__)
+    #if defined(__AVX2__)
+        #include <immintrin.h>
+    #elif defined(__SSE2__) || defined(_M_X64)
+        #include <emmintrin.h>
+        #define FIND_WORD_SSE2
+    #endif
+#endif
+
+namespace reclamation { namespace techniques { namespace utils {
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t) && std::atomic<std::uint32_t>::is_always_lock_free,
+    "find_word requires lock-free 32 bit atomics without padding");
+
+// Returns the index of the first of the n words that is equal to value, or n if there is none.
+// For relaxed scans the words are compared in vector registers (AVX2 or SSE2, whatever the target
+// supports). Each lane is a naturally aligned 32 bit load, so no torn values can be observed, but
+// the lanes are not ordered with respect to each other - which is fine for a relaxed scan.
+// TSan builds and non-relaxed scans always take the scalar path.
+inline std::size_t find_word(const std::atomic<std::uint32_t>* words, std::size_t n, std::uint32_t value,
+                             std::memory_order order = std::memory_order_relaxed)
+{
+    std::size_t i = 0;
+    if (order == std::memory_order_relaxed)
+    {
+        auto raw = reinterpret_cast<const std::uint32_t*>(words);
+#if defined(__AVX2__) && !defined(__SANITIZE_THREAD__)
+        const __m256i needle = _mm256_set1_epi32(static_cast<int>(value));
+        for (; i + 8 <= n; i += 8)
+        {
+            auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(raw + i));
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(v, needle)) != 0)
+                break;
+        }
+#elif defined(FIND_WORD_SSE2)
+        const __m128i needle = _mm_set1_epi32(static_cast<int>(value));
+        for (; i + 4 <= n; i += 4)
+        {
+            auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(raw + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(v, needle)) != 0)
+                break;
+        }
+#else
+        (void)raw;
+#endif
+    }
+
+    // scalar tail - also pins down the exact lane after a vector hit
+    for (; i < n; ++i)
+        if (words[i].load(order) == value)
+            return i;
+    return n;
+}
+
+}}}
+
+#undef FIND_WORD_SSE2
+
+#endif
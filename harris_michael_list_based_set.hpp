@@ -0,0 +1,174 @@
+#ifndef _HARRIS_MICHAEL_LIST_BASED_SET_
+#define _HARRIS_MICHAEL_LIST_BASED_SET_
+
+#include <atomic>
+#include <functional>
+#include <utility>
+
+namespace reclamation {
+
+// Lock-free ordered set of keys based on Harris' linked list with Michael's improvements.
+// A node is logically deleted by setting the mark bit of its next pointer and physically
+// removed (and retired through the Reclaimer) by whichever thread unlinks it first.
+template <class Key, class Reclaimer, class Compare = std::less<Key>>
+class harris_michael_list_based_set {
+public:
+    harris_michael_list_based_set() = default;
+    ~harris_michael_list_based_set();
+
+    harris_michael_list_based_set(const harris_michael_list_based_set&) = delete;
+    harris_michael_list_based_set& operator=(const harris_michael_list_based_set&) = delete;
+
+    // Returns false if an equal key was already present.
+    bool insert(Key key);
+
+    // Returns false if no equal key was present.
+    bool erase(const Key& key);
+
+    bool contains(const Key& key);
+
+private:
+    struct node;
+    using concurrent_ptr = typename Reclaimer::template concurrent_ptr<node, 1>;
+    using marked_ptr = typename concurrent_ptr::marked_ptr;
+    using guard_ptr = typename concurrent_ptr::guard_ptr;
+    using region_guard = typename Reclaimer::region_guard;
+
+    struct node : Reclaimer::template enable_concurrent_ptr<node, 1> {
+        explicit node(Key&& key) : key(std::move(key)) {}
+
+        const Key key;
+        concurrent_ptr next;
+    };
+
+    // Position found by find: prev points to the link that contains cur,
+    // save protects the node that owns prev.
+    struct find_info {
+        concurrent_ptr* prev;
+        marked_ptr next;
+        guard_ptr cur;
+        guard_ptr save;
+    };
+
+    // Searches for the first node with a key that is not less than key, unlinking marked
+    // nodes on the way. Returns true if that node's key is equal to key.
+    bool find(const Key& key, find_info& info);
+
+    Compare compare;
+    concurrent_ptr head;
+};
+
+template <class Key, class Reclaimer, class Compare>
+harris_michael_list_based_set<Key, Reclaimer, Compare>::~harris_michael_list_based_set() {
+    // No concurrent accesses are allowed anymore, so the nodes can be deleted directly.
+    auto n = head.load(std::memory_order_relaxed);
+    while (n)
+    {
+        auto next = n->next.load(std::memory_order_relaxed);
+        delete n.get();
+        n = next;
+    }
+}
+
+template <class Key, class Reclaimer, class Compare>
+bool harris_michael_list_based_set<Key, Reclaimer, Compare>::find(const Key& key, find_info& info) {
+retry:
+    info.prev = &head;
+    info.next = info.prev->load(std::memory_order_relaxed);
+    info.save.reset();
+    for (;;)
+    {
+        // (1) - this acquire-load synchronizes-with the release-CAS (2, 3, 4)
+        if (!info.cur.acquire_if_equal(*info.prev, info.next, std::memory_order_acquire))
+            goto retry;
+
+        if (!info.cur)
+            return false;
+
+        info.next = info.cur->next.load(std::memory_order_relaxed);
+        if (info.next.mark() != 0)
+        {
+            // cur is logically deleted - try to unlink it.
+            info.next = marked_ptr(info.next.get(), 0);
+            marked_ptr expected(info.cur.get());
+            // (2) - this release-CAS synchronizes-with the acquire-load (1)
+            if (!info.prev->compare_exchange_weak(expected, info.next,
+                    std::memory_order_release, std::memory_order_relaxed))
+                goto retry;
+            info.cur.reclaim();
+        }
+        else
+        {
+            if (info.prev->load(std::memory_order_relaxed) != info.cur.get())
+                goto retry;
+
+            const Key& ckey = info.cur->key;
+            if (!compare(ckey, key))
+                return !compare(key, ckey);
+
+            info.prev = &info.cur->next;
+            std::swap(info.save, info.cur);
+        }
+    }
+}
+
+template <class Key, class Reclaimer, class Compare>
+bool harris_michael_list_based_set<Key, Reclaimer, Compare>::insert(Key key) {
+    region_guard critical_region;
+    node* n = nullptr;
+    find_info info;
+    for (;;)
+    {
+        // once the node exists, key has been moved into it
+        if (find(n == nullptr ? key : n->key, info))
+        {
+            delete n;
+            return false;
+        }
+
+        if (n == nullptr)
+            n = new node(std::move(key));
+        n->next.store(marked_ptr(info.cur.get()), std::memory_order_relaxed);
+
+        marked_ptr expected(info.cur.get());
+        // (3) - this release-CAS synchronizes-with the acquire-load (1)
+        if (info.prev->compare_exchange_weak(expected, n, std::memory_order_release, std::memory_order_relaxed))
+            return true;
+    }
+}
+
+template <class Key, class Reclaimer, class Compare>
+bool harris_michael_list_based_set<Key, Reclaimer, Compare>::erase(const Key& key) {
+    region_guard critical_region;
+    find_info info;
+    for (;;)
+    {
+        if (!find(key, info))
+            return false;
+
+        // Logically delete cur by marking its next pointer.
+        auto next = info.next;
+        if (info.cur->next.compare_exchange_weak(next, marked_ptr(next.get(), 1),
+                std::memory_order_acquire, std::memory_order_relaxed))
+            break;
+    }
+
+    marked_ptr expected(info.cur.get());
+    // (4) - this release-CAS synchronizes-with the acquire-load (1)
+    if (info.prev->compare_exchange_weak(expected, info.next, std::memory_order_release, std::memory_order_relaxed))
+        info.cur.reclaim();
+    else
+        find(key, info); // let find unlink the marked node
+
+    return true;
+}
+
+template <class Key, class Reclaimer, class Compare>
+bool harris_michael_list_based_set<Key, Reclaimer, Compare>::contains(const Key& key) {
+    region_guard critical_region;
+    find_info info;
+    return find(key, info);
+}
+}
+
+#endif
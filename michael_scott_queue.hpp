@@ -0,0 +1,130 @@
+#ifndef _MICHAEL_SCOTT_QUEUE_
+#define _MICHAEL_SCOTT_QUEUE_
+
+#include <atomic>
+#include <utility>
+
+namespace reclamation {
+
+// Unbounded lock-free multi-producer/multi-consumer FIFO queue by Michael and Scott.
+// Dequeued nodes are retired through the Reclaimer; T must be default constructible
+// because the queue always holds a dummy node.
+template <class T, class Reclaimer>
+class michael_scott_queue {
+public:
+    michael_scott_queue();
+    ~michael_scott_queue();
+
+    michael_scott_queue(const michael_scott_queue&) = delete;
+    michael_scott_queue& operator=(const michael_scott_queue&) = delete;
+
+    void push(T value);
+
+    // Returns false if the queue was empty, otherwise moves the front element to result.
+    bool try_pop(T& result);
+
+private:
+    struct node;
+    using concurrent_ptr = typename Reclaimer::template concurrent_ptr<node, 0>;
+    using marked_ptr = typename concurrent_ptr::marked_ptr;
+    using guard_ptr = typename concurrent_ptr::guard_ptr;
+    using region_guard = typename Reclaimer::region_guard;
+
+    struct node : Reclaimer::template enable_concurrent_ptr<node> {
+        node() : value() {}
+        explicit node(T&& value) : value(std::move(value)) {}
+
+        T value;
+        concurrent_ptr next;
+    };
+
+    alignas(64) concurrent_ptr head;
+    alignas(64) concurrent_ptr tail;
+};
+
+template <class T, class Reclaimer>
+michael_scott_queue<T, Reclaimer>::michael_scott_queue() {
+    auto dummy = new node();
+    head.store(dummy, std::memory_order_relaxed);
+    tail.store(dummy, std::memory_order_relaxed);
+}
+
+template <class T, class Reclaimer>
+michael_scott_queue<T, Reclaimer>::~michael_scott_queue() {
+    // No concurrent accesses are allowed anymore, so the nodes can be deleted directly.
+    auto n = head.load(std::memory_order_relaxed);
+    while (n)
+    {
+        auto next = n->next.load(std::memory_order_relaxed);
+        delete n.get();
+        n = next;
+    }
+}
+
+template <class T, class Reclaimer>
+void michael_scott_queue<T, Reclaimer>::push(T value) {
+    auto n = new node(std::move(value));
+    region_guard critical_region;
+    guard_ptr t;
+    for (;;)
+    {
+        // (1) - this acquire-load synchronizes-with the release-CAS (2, 3)
+        t.acquire(tail, std::memory_order_acquire);
+        auto next = t->next.load(std::memory_order_acquire);
+        if (next)
+        {
+            // tail is lagging behind - help to move it forward.
+            marked_ptr expected(t.get());
+            // (2) - this release-CAS synchronizes-with the acquire-load (1)
+            tail.compare_exchange_weak(expected, next, std::memory_order_release, std::memory_order_relaxed);
+            continue;
+        }
+
+        marked_ptr null;
+        // (3) - this release-CAS synchronizes-with the acquire-load (1, 4)
+        if (t->next.compare_exchange_weak(null, n, std::memory_order_release, std::memory_order_relaxed))
+            break;
+    }
+
+    marked_ptr expected(t.get());
+    tail.compare_exchange_strong(expected, n, std::memory_order_release, std::memory_order_relaxed);
+}
+
+template <class T, class Reclaimer>
+bool michael_scott_queue<T, Reclaimer>::try_pop(T& result) {
+    region_guard critical_region;
+    guard_ptr h;
+    guard_ptr next;
+    for (;;)
+    {
+        // (4) - this acquire-load synchronizes-with the release-CAS (3, 5)
+        h.acquire(head, std::memory_order_acquire);
+        next.acquire(h->next, std::memory_order_acquire);
+        if (head.load(std::memory_order_relaxed) != h.get())
+            continue;
+
+        if (!next)
+            return false;
+
+        auto t = tail.load(std::memory_order_relaxed);
+        if (t == h.get())
+        {
+            // tail points to the node we are about to remove - move it forward first.
+            tail.compare_exchange_weak(t, next, std::memory_order_release, std::memory_order_relaxed);
+            continue;
+        }
+
+        marked_ptr expected(h.get());
+        // (5) - this release-CAS synchronizes-with the acquire-load (4)
+        if (head.compare_exchange_weak(expected, next, std::memory_order_release, std::memory_order_relaxed))
+            break;
+    }
+
+    // next is the new dummy node; its value is owned by us now.
+    result = std::move(next->value);
+    h.reclaim();
+    return true;
+}
+}
+
+#endif
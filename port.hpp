@@ -24,4 +24,11 @@
     #error "Unsupported compiler"
 #endif
 
+#if defined(BOOST_COMP_MSVC_DETECTION)
+    #include <intrin.h>
+    #define PREFETCH(addr) _mm_prefetch(reinterpret_cast<const char*>(addr), _MM_HINT_T0)
+#else
+    #define PREFETCH(addr) __builtin_prefetch(addr)
+#endif
+
 #endif
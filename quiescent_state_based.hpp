@@ -0,0 +1,381 @@
+#ifndef _QUIESCENT_STATE_BASED_
+#define _QUIESCENT_STATE_BASED_
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+#include "allocation_tracker.hpp"
+#include "concurrent_ptr.hpp"
+#include "deletable_object.hpp"
+#include "guard_ptr.hpp"
+#include "port.hpp"
+#include "retire_list.hpp"
+#include "thread_block_list.hpp"
+
+namespace reclamation { namespace techniques {
+
+// Quiescent state based reclamation. Offers the same interface as epoch_based, but guard_ptrs
+// do not enter any critical region: acquiring a guard is a plain load. Instead, every thread that
+// uses the reclaimer must regularly call quiescent_state() at a point where it does not hold any
+// guard_ptr or reference to a shared object. A retired object is reclaimed once all threads have
+// passed through a quiescent state after its retirement, so a thread that stops calling
+// quiescent_state() (without exiting) blocks all reclamation.
+//
+// A thread registers itself when it first enters a region_guard, passes through a quiescent state
+// or retires an object, and deregisters when it exits. Guards may only be acquired by registered
+// threads (debug builds assert this), so that acquiring stays a plain load; the data structures
+// register through the region_guard of every operation. Every UpdateThreshold quiescent states a
+// thread tries to advance the global epoch.
+template <std::size_t UpdateThreshold>
+class quiescent_state_based {
+    template <class T, class MarkedPtr>
+    class guard_ptr;
+
+public:
+    template <class T, std::size_t N = 0, class Deleter = std::default_delete<T>>
+    class enable_concurrent_ptr;
+
+    class region_guard;
+
+    template <class T, std::size_t N = T::number_of_mark_bits>
+    using concurrent_ptr = utils::concurrent_ptr<T, N, guard_ptr>;
+
+    // Declares that the current thread holds no references to shared objects right now.
+    static void quiescent_state();
+
+    ALLOCATION_TRACKER;
+
+private:
+    static constexpr unsigned number_epochs = 3;
+
+    struct thread_data;
+    struct thread_control_block;
+
+    static std::atomic<unsigned> global_epoch;
+    static utils::thread_block_list<thread_control_block, utils::orphan> global_thread_block_list;
+    static thread_data& local_thread_data();
+
+    ALLOCATION_TRACKING_FUNCTIONS;
+};
+
+// Critical regions are implicit between two quiescent states, so a region_guard only makes sure
+// that the thread is registered; data structures written against the epoch_based interface may
+// read shared objects under nothing but a region_guard. The thread must not call
+// quiescent_state() while a region_guard is alive.
+template <std::size_t UpdateThreshold>
+class quiescent_state_based<UpdateThreshold>::region_guard {
+public:
+    region_guard();
+    ~region_guard() = default;
+
+    region_guard(const region_guard&) = delete;
+    region_guard(region_guard&&) = delete;
+    region_guard& operator=(const region_guard&) = delete;
+    region_guard& operator=(region_guard&&) = delete;
+};
+
+template <std::size_t UpdateThreshold>
+template <class T, std::size_t N, class Deleter>
+class quiescent_state_based<UpdateThreshold>::enable_concurrent_ptr : private utils::reclaimable_object_impl<T, Deleter>, private utils::tracked_object<quiescent_state_based> {
+public:
+    static constexpr std::size_t number_of_mark_bits = N;
+
+protected:
+    enable_concurrent_ptr() = default;
+    enable_concurrent_ptr(const enable_concurrent_ptr&) = default;
+    enable_concurrent_ptr(enable_concurrent_ptr&&) = default;
+    enable_concurrent_ptr& operator=(const enable_concurrent_ptr&) = default;
+    enable_concurrent_ptr& operator=(enable_concurrent_ptr&&) = default;
+    ~enable_concurrent_ptr() = default;
+
+private:
+    friend utils::reclaimable_object_impl<T, Deleter>;
+
+    template <class, class>
+    friend class guard_ptr;
+};
+
+template <std::size_t UpdateThreshold>
+template <class T, class MarkedPtr>
+class quiescent_state_based<UpdateThreshold>::guard_ptr : public utils::guard_ptr<T, MarkedPtr, guard_ptr<T, MarkedPtr>> {
+    using base = utils::guard_ptr<T, MarkedPtr, guard_ptr>;
+    using Deleter = typename T::Deleter;
+public:
+    // Guard a marked ptr.
+    guard_ptr(const MarkedPtr& p = MarkedPtr()) ;
+    explicit guard_ptr(const guard_ptr& p) ;
+    guard_ptr(guard_ptr&& p) ;
+
+    guard_ptr& operator=(const guard_ptr& p) ;
+    guard_ptr& operator=(guard_ptr&& p) ;
+
+    // Atomically take snapshot of p, and *if* it points to unreclaimed object, acquire shared ownership of it.
+    void acquire(const concurrent_ptr<T>& p, std::memory_order order = std::memory_order_seq_cst) ;
+
+    // Like acquire, but quit early if a snapshot != expected.
+    bool acquire_if_equal(const concurrent_ptr<T>& p,
+                                                const MarkedPtr& expected,
+                                                std::memory_order order = std::memory_order_seq_cst) ;
+
+    // Release ownership. Postcondition: get() == nullptr.
+    void reset() ;
+
+    // Reset. Deleter d will be applied some time after all threads passed through a quiescent state.
+    void reclaim(Deleter d = Deleter()) ;
+};
+
+template <std::size_t UpdateThreshold>
+quiescent_state_based<UpdateThreshold>::region_guard::region_guard() {
+    local_thread_data().ensure_online();
+}
+
+template <std::size_t UpdateThreshold>
+template <class T, class MarkedPtr>
+quiescent_state_based<UpdateThreshold>::guard_ptr<T, MarkedPtr>::guard_ptr(const MarkedPtr& p) : base(p) {
+    if (this->ptr)
+        local_thread_data().ensure_online();
+}
+
+template <std::size_t UpdateThreshold>
+template <class T, class MarkedPtr>
+quiescent_state_based<UpdateThreshold>::guard_ptr<T, MarkedPtr>::guard_ptr(const guard_ptr& p) : base(p.ptr) {}
+
+template <std::size_t UpdateThreshold>
+template <class T, class MarkedPtr>
+quiescent_state_based<UpdateThreshold>::guard_ptr<T, MarkedPtr>::guard_ptr(guard_ptr&& p) : base(p.ptr) {
+    p.ptr.reset();
+}
+
+template <std::size_t UpdateThreshold>
+template <class T, class MarkedPtr>
+auto quiescent_state_based<UpdateThreshold>::guard_ptr<T, MarkedPtr>::operator=(const guard_ptr& p) -> guard_ptr& {
+    this->ptr = p.ptr;
+    return *this;
+}
+
+template <std::size_t UpdateThreshold>
+template <class T, class MarkedPtr>
+auto quiescent_state_based<UpdateThreshold>::guard_ptr<T, MarkedPtr>::operator=(guard_ptr&& p) -> guard_ptr& {
+    if (&p == this)
+        return *this;
+
+    this->ptr = std::move(p.ptr);
+    p.ptr.reset();
+    return *this;
+}
+
+template <std::size_t UpdateThreshold>
+template <class T, class MarkedPtr>
+void quiescent_state_based<UpdateThreshold>::guard_ptr<T, MarkedPtr>::acquire(const concurrent_ptr<T>& p, std::memory_order order) {
+    assert(local_thread_data().is_online());
+    // (1) - this load operation potentially synchronizes-with any release operation on p.
+    this->ptr = p.load(order);
+}
+
+template <std::size_t UpdateThreshold>
+template <class T, class MarkedPtr>
+bool quiescent_state_based<UpdateThreshold>::guard_ptr<T, MarkedPtr>::acquire_if_equal(
+    const concurrent_ptr<T>& p,
+    const MarkedPtr& expected,
+    std::memory_order order)
+{
+    assert(local_thread_data().is_online());
+    // (2) - this load operation potentially synchronizes-with any release operation on p.
+    auto actual = p.load(order);
+    if (actual != expected)
+    {
+        this->ptr.reset();
+        return false;
+    }
+
+    this->ptr = actual;
+    return true;
+}
+
+template <std::size_t UpdateThreshold>
+template <class T, class MarkedPtr>
+void quiescent_state_based<UpdateThreshold>::guard_ptr<T, MarkedPtr>::reset() {
+    this->ptr.reset();
+}
+
+template <std::size_t UpdateThreshold>
+template <class T, class MarkedPtr>
+void quiescent_state_based<UpdateThreshold>::guard_ptr<T, MarkedPtr>::reclaim(Deleter d) {
+    this->ptr->set_deleter(std::move(d));
+    local_thread_data().add_retired_node(T::retire_pointer(this->ptr.get()), T::reclaim);
+    reset();
+}
+
+template <std::size_t UpdateThreshold>
+struct quiescent_state_based<UpdateThreshold>::thread_control_block : utils::thread_block_list<thread_control_block>::entry {
+    // The last epoch the thread has observed in a quiescent state, and a flag that is set while
+    // the thread is registered. A newly created or released entry holds 0, which blocks no one.
+    static constexpr unsigned announce(unsigned epoch) {
+        return (epoch << 1) | 1u;
+    }
+};
+
+template <std::size_t UpdateThreshold>
+struct quiescent_state_based<UpdateThreshold>::thread_data
+{
+    bool is_online() const { return control_block != nullptr; }
+
+    void ensure_online() {
+        if (control_block == nullptr)
+            go_online();
+    }
+
+    void quiescent_state() {
+        if (control_block == nullptr)
+        {
+            go_online();
+            return;
+        }
+
+        // (3) - this acquire-load synchronizes-with the release-CAS (6)
+        auto epoch = global_epoch.load(std::memory_order_acquire);
+        if (local_epoch == epoch)
+        {
+            if (states_since_update++ < UpdateThreshold)
+                return;
+            states_since_update = 0;
+            if (!try_update_epoch(epoch))
+                return;
+            epoch = (epoch + 1) % number_epochs;
+        }
+        states_since_update = 0;
+
+        // We observe a new epoch, so everything that we retired in the previous incarnation of
+        // this epoch has been retired before all other threads passed through a quiescent state.
+        local_epoch = epoch;
+        control_block->publish_hint(thread_control_block::announce(epoch));
+        // (4) - this release-store synchronizes-with the acquire-fence (5)
+        control_block->announcement().store(thread_control_block::announce(epoch), std::memory_order_release);
+        retire_lists[epoch].delete_objects(&chunk_pool);
+    }
+
+    void add_retired_node(void* p, utils::reclaim_function reclaim) {
+        ensure_online();
+        retire_lists[local_epoch].push(p, reclaim, chunk_pool);
+    }
+
+    ~thread_data() {
+        if (control_block == nullptr)
+            return; // nothing to do
+
+        // A thread that exits holds no references, so it stops blocking epoch updates right away.
+        control_block->announcement().store(0, std::memory_order_release);
+
+        if (std::any_of(retire_lists.begin(), retire_lists.end(), [](auto& l) { return !l.empty(); }))
+        {
+            // global_epoch - 1 (mod number_epochs) is reached after two more epoch updates, the
+            // second of which requires all other threads to pass through a quiescent state
+            // after this point.
+            auto target_epoch = (global_epoch.load(std::memory_order_relaxed) + number_epochs - 1) % number_epochs;
+            for (unsigned i = 1; i < number_epochs; ++i)
+                retire_lists[0].append(retire_lists[i]);
+
+            global_thread_block_list.abandon_retired_nodes(new utils::orphan(target_epoch, retire_lists[0], 0, 0));
+        }
+
+        global_thread_block_list.release_entry(control_block);
+    }
+
+private:
+    void go_online() {
+        control_block = global_thread_block_list.acquire_entry();
+
+        // Announce the current epoch; if it has changed before the announcement became visible,
+        // an epoch update might have missed it, so try again.
+        auto epoch = global_epoch.load(std::memory_order_relaxed);
+        do
+        {
+            local_epoch = epoch;
+            control_block->publish_hint(thread_control_block::announce(epoch));
+            control_block->announcement().store(thread_control_block::announce(epoch), std::memory_order_relaxed);
+            // (7) - this seq_cst-fence enforces a total order with the seq_cst-fence (8)
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            epoch = global_epoch.load(std::memory_order_acquire);
+        } while (epoch != local_epoch);
+    }
+
+    bool try_update_epoch(unsigned curr_epoch) {
+        const auto old_epoch = (curr_epoch + number_epochs - 1) % number_epochs;
+        const auto new_epoch = (curr_epoch + 1) % number_epochs;
+
+        // (8) - this seq_cst-fence enforces a total order with the seq_cst-fence (7)
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        // If any thread has not passed through a quiescent state in the current epoch, abort the attempt.
+        // TSan does not support explicit fences, so we cannot rely on the acquire-fence (5)
+        // but have to perform acquire-loads here to avoid false positives.
+        constexpr auto memory_order = TSAN_MEMORY_ORDER(std::memory_order_acquire, std::memory_order_relaxed);
+        if (global_thread_block_list.find_announcement(thread_control_block::announce(old_epoch), memory_order) != nullptr)
+            return false;
+
+        // (5) - this acquire-fence synchronizes-with the release-store (4)
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        // (6) - this release-CAS synchronizes-with the acquire-load (3)
+        if (!global_epoch.compare_exchange_strong(curr_epoch, new_epoch, std::memory_order_release, std::memory_order_relaxed))
+            return false;
+
+        adopt_orphans();
+        return true;
+    }
+
+    void adopt_orphans() {
+        auto current = global_thread_block_list.adopt_abandoned_retired_nodes();
+        for (utils::orphan* next = nullptr; current != nullptr; current = next)
+        {
+            next = current->next;
+            retire_lists[current->target_epoch].append(current->nodes);
+            delete current;
+        }
+    }
+
+    unsigned states_since_update = 0;
+    unsigned local_epoch = number_epochs;
+    thread_control_block* control_block = nullptr;
+    utils::chunk_pool chunk_pool;
+    std::array<utils::retire_list, number_epochs> retire_lists;
+
+    friend class quiescent_state_based;
+    ALLOCATION_COUNTER(quiescent_state_based);
+};
+
+//GLOBALS
+template <std::size_t UpdateThreshold>
+std::atomic<unsigned> quiescent_state_based<UpdateThreshold>::global_epoch;
+
+template <std::size_t UpdateThreshold>
+utils::thread_block_list<typename quiescent_state_based<UpdateThreshold>::thread_control_block, utils::orphan>
+    quiescent_state_based<UpdateThreshold>::global_thread_block_list;
+
+template <std::size_t UpdateThreshold>
+inline typename quiescent_state_based<UpdateThreshold>::thread_data& quiescent_state_based<UpdateThreshold>::local_thread_data() {
+    static thread_local thread_data local_thread_data;
+    return local_thread_data;
+}
+
+template <std::size_t UpdateThreshold>
+void quiescent_state_based<UpdateThreshold>::quiescent_state() {
+    local_thread_data().quiescent_state();
+}
+
+#ifdef TRACK_ALLOCATIONS
+template <std::size_t UpdateThreshold>
+utils::allocation_tracker quiescent_state_based<UpdateThreshold>::allocation_tracker;
+
+template <std::size_t UpdateThreshold>
+inline void quiescent_state_based<UpdateThreshold>::count_allocation()
+{ local_thread_data().allocation_counter.count_allocation(); }
+
+template <std::size_t UpdateThreshold>
+inline void quiescent_state_based<UpdateThreshold>::count_reclamation()
+{ local_thread_data().allocation_counter.count_reclamation(); }
+#endif
+}}
+
+#endif
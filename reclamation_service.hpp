@@ -0,0 +1,201 @@
+#ifndef _RECLAMATION_SERVICE_
+#define _RECLAMATION_SERVICE_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "recycling_pool.hpp"
+#include "retire_list.hpp"
+
+namespace reclamation { namespace techniques { namespace utils {
+
+// A pool of background threads that runs the deleters of expired retire lists, so that
+// the threads handing them over never execute destructors themselves.
+// Lists are handed over in O(1) by splicing them onto a shared stack. The emptied chunks are kept
+// on a second stack, from which submitting threads refill their chunk pools. That stack's head
+// and its number of chunks share one word, so that both are updated and read in O(1).
+class reclamation_service {
+public:
+    // upper bound for the chunks kept for reuse; batches that do not fit anymore are freed
+    static constexpr std::size_t max_free_chunks = 256;
+
+    reclamation_service() = default;
+    reclamation_service(const reclamation_service&) = delete;
+    reclamation_service& operator=(const reclamation_service&) = delete;
+
+    ~reclamation_service() {
+        stop();
+        delete_chunks(take_free_chunks());
+    }
+
+    // Starts the given number of worker threads. Does nothing if the service is already running.
+    void start(unsigned threads) {
+        std::lock_guard<std::mutex> lock(control_mutex);
+        if (!workers.empty())
+            return;
+
+        stopping = false;
+        for (unsigned i = 0; i < threads; ++i)
+            workers.emplace_back([this]() { work(); });
+        running.store(true, std::memory_order_seq_cst);
+    }
+
+    // Stops all worker threads after they have reclaimed everything that was handed over.
+    void stop() {
+        std::lock_guard<std::mutex> lock(control_mutex);
+        if (workers.empty())
+            return;
+
+        running.store(false, std::memory_order_seq_cst);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto& t : workers)
+            t.join();
+        workers.clear();
+        drain();
+    }
+
+    bool is_running() const { return running.load(std::memory_order_relaxed); }
+
+    // Hands over the chunks first..last (linked via next); last->next is overwritten.
+    void submit(retire_chunk* first, retire_chunk* last) {
+        auto h = pending.load(std::memory_order_relaxed);
+        do {
+            last->next = h;
+            // (1) - this release-CAS synchronizes-with the acquire-exchange (2)
+        } while (!pending.compare_exchange_weak(h, first, std::memory_order_seq_cst, std::memory_order_relaxed));
+
+        // if the service was stopped concurrently, nobody else is going to reclaim our list
+        if (!running.load(std::memory_order_seq_cst))
+        {
+            drain();
+            return;
+        }
+
+        if (sleeping.load(std::memory_order_seq_cst) > 0)
+        {
+            { std::lock_guard<std::mutex> lock(mutex); }
+            cv.notify_one();
+        }
+    }
+
+    // Takes all emptied chunks, linked via next, or returns nullptr if there are none.
+    retire_chunk* take_free_chunks() {
+        if (free_chunks.load(std::memory_order_relaxed) == 0)
+            return nullptr;
+
+        // (4) - this acquire-exchange synchronizes-with the release-CAS (3)
+        return head_of(free_chunks.exchange(0, std::memory_order_acquire));
+    }
+
+private:
+    void work() {
+        // blocks reclaimed here were allocated by other threads and would never get back to them
+        recycling_pool::bypass_for_this_thread();
+        for (;;)
+        {
+            drain();
+
+            std::unique_lock<std::mutex> lock(mutex);
+            sleeping.fetch_add(1, std::memory_order_seq_cst);
+            // the timeout is only a safety net, submit notifies sleeping workers
+            cv.wait_for(lock, std::chrono::milliseconds(100), [this]() {
+                return stopping || pending.load(std::memory_order_seq_cst) != nullptr;
+            });
+            sleeping.fetch_sub(1, std::memory_order_relaxed);
+            if (stopping)
+                return;
+        }
+    }
+
+    void drain() {
+        while (pending.load(std::memory_order_relaxed) != nullptr)
+        {
+            // (2) - this acquire-exchange synchronizes-with the release-CAS (1)
+            auto chunks = pending.exchange(nullptr, std::memory_order_acquire);
+
+            // the chunks are not reachable from any retire list, so destructors that retire
+            // further objects cannot modify them
+            retire_chunk* last = nullptr;
+            std::size_t count = 0;
+            for (auto c = chunks; c != nullptr; c = c->next)
+            {
+                c->reclaim(c->objects, c->count);
+                last = c;
+                ++count;
+            }
+            recycle(chunks, last, count);
+        }
+    }
+
+    void recycle(retire_chunk* first, retire_chunk* last, std::size_t count) {
+        const auto address = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(first));
+        if ((address >> count_shift) != 0)
+        {
+            // the address leaves no room for the count
+            delete_chunks(first);
+            return;
+        }
+
+        auto h = free_chunks.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            const auto total = (h >> count_shift) + count;
+            if (total > max_free_chunks)
+            {
+                delete_chunks(first);
+                return;
+            }
+
+            last->next = head_of(h);
+            // (3) - this release-CAS synchronizes-with the acquire-exchange (4)
+            if (free_chunks.compare_exchange_weak(h, address | (total << count_shift),
+                    std::memory_order_release, std::memory_order_relaxed))
+                return;
+        }
+    }
+
+    static retire_chunk* head_of(std::uint64_t packed) {
+        return reinterpret_cast<retire_chunk*>(static_cast<std::uintptr_t>(packed & address_mask));
+    }
+
+    // frees the (already reclaimed) chunks first..nullptr
+    static void delete_chunks(retire_chunk* first) {
+        while (first)
+        {
+            auto next = first->next;
+            delete first;
+            first = next;
+        }
+    }
+
+    std::atomic<retire_chunk*> pending{nullptr};
+    // The address of the top chunk in the low bits and the number of chunks in the top 16 bits;
+    // user space addresses leave them clear on the common 64 bit platforms. A stack is only ever
+    // taken as a whole, so the packed word is not subject to ABA problems.
+    static constexpr unsigned count_shift = 48;
+    static constexpr std::uint64_t address_mask = (std::uint64_t(1) << count_shift) - 1;
+    static_assert(max_free_chunks < (std::uint64_t(1) << (64 - count_shift)), "the count must fit into the top bits");
+    std::atomic<std::uint64_t> free_chunks{0};
+    std::atomic<bool> running{false};
+    std::atomic<unsigned> sleeping{0};
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+
+    std::mutex control_mutex;
+    std::vector<std::thread> workers;
+};
+
+}}}
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef _RECYCLING_POOL_
+#define _RECYCLING_POOL_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace reclamation { namespace techniques { namespace utils {
+
+// Per-thread freelists of memory blocks, grouped into size classes. Reclaimed nodes are pushed
+// onto the freelist of the thread that reclaims them, and allocations pop from the freelist of
+// the allocating thread first, so that steady-state allocate/retire/reclaim cycles do not go
+// through the global allocator.
+// Blocks larger than max_block_size or with an alignment above the default new alignment are
+// passed straight through to operator new/delete, and so are all blocks of threads whose cache has
+// been destroyed already or that bypass the pool.
+class recycling_pool {
+public:
+    static constexpr std::size_t granularity = 16;
+    static constexpr std::size_t max_block_size = 256;
+
+    static void* allocate(std::size_t size) {
+        if (!is_pooled(size))
+            return ::operator new(size);
+
+        auto cache = local_cache();
+        if (cache == nullptr)
+            return ::operator new(class_size(size_class(size)));
+
+        auto& list = cache->lists[size_class(size)];
+        if (list.head == nullptr)
+            return ::operator new(class_size(size_class(size)));
+
+        auto result = list.head;
+        list.head = result->next;
+        --list.size;
+        return result;
+    }
+
+    // size must be the size that was passed to allocate.
+    static void deallocate(void* p, std::size_t size) {
+        if (!is_pooled(size))
+        {
+            ::operator delete(p);
+            return;
+        }
+
+        auto cache = local_cache();
+        if (cache == nullptr)
+        {
+            ::operator delete(p);
+            return;
+        }
+
+        auto& list = cache->lists[size_class(size)];
+        if (list.size >= capacity.load(std::memory_order_relaxed))
+        {
+            ::operator delete(p);
+            return;
+        }
+
+        auto b = static_cast<block*>(p);
+        b->next = list.head;
+        list.head = b;
+        ++list.size;
+    }
+
+    // Maximum number of blocks each thread caches per size class; further blocks are freed.
+    static void set_capacity(std::size_t blocks) { capacity.store(blocks, std::memory_order_relaxed); }
+    static std::size_t get_capacity() { return capacity.load(std::memory_order_relaxed); }
+
+    // Number of blocks the calling thread currently caches for the given block size.
+    static std::size_t cached_blocks(std::size_t size) {
+        auto cache = local_cache();
+        return is_pooled(size) && cache != nullptr ? cache->lists[size_class(size)].size : 0;
+    }
+
+    // Returns all blocks cached by the calling thread to the system allocator.
+    static void release_memory() {
+        if (auto cache = local_cache())
+            cache->release();
+    }
+
+    // Makes the calling thread pass all blocks straight through to operator new/delete, e.g.,
+    // for threads that reclaim on behalf of others and would otherwise hoard their blocks.
+    static void bypass_for_this_thread() {
+        release_memory();
+        state = cache_state::bypassed;
+    }
+
+private:
+    struct block {
+        block* next;
+    };
+
+    struct freelist {
+        block* head = nullptr;
+        std::size_t size = 0;
+    };
+
+    static constexpr std::size_t number_of_classes = max_block_size / granularity;
+
+    struct thread_cache {
+        std::array<freelist, number_of_classes> lists;
+
+        void release() {
+            for (auto& list : lists)
+            {
+                while (list.head)
+                {
+                    auto next = list.head->next;
+                    ::operator delete(list.head);
+                    list.head = next;
+                }
+                list.size = 0;
+            }
+        }
+
+        thread_cache() { state = cache_state::active; }
+        ~thread_cache() {
+            release();
+            state = cache_state::bypassed;
+        }
+    };
+
+    // The cache is a thread_local with a destructor, so thread_locals that were first used before it
+    // (e.g., a reclaimer's thread data) are destroyed after it and may still reclaim blocks. The state
+    // is trivially destructible, so it remains valid until the thread has exited.
+    enum class cache_state : unsigned char { unused, active, bypassed };
+    static inline thread_local cache_state state = cache_state::unused;
+
+    static bool is_pooled(std::size_t size) { return size != 0 && size <= max_block_size; }
+    static std::size_t size_class(std::size_t size) { return (size - 1) / granularity; }
+    static std::size_t class_size(std::size_t size_class) { return (size_class + 1) * granularity; }
+
+    // Returns nullptr if the calling thread bypasses the pool.
+    static thread_cache* local_cache() {
+        if (state == cache_state::bypassed)
+            return nullptr;
+        static thread_local thread_cache cache;
+        return &cache;
+    }
+
+    static inline std::atomic<std::size_t> capacity{1024};
+};
+
+// Deleter that destroys the object and hands its memory to the recycling_pool. It is empty, so
+// objects using it are reclaimed without virtual dispatch.
+template <class T>
+struct recycling_deleter {
+    void operator()(T* p) const {
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "over-aligned types are not supported");
+        p->~T();
+        recycling_pool::deallocate(p, sizeof(T));
+    }
+};
+
+// Allocates memory from the recycling_pool and constructs a T in it. Objects created this way
+// must be released with recycling_deleter<T>.
+template <class T, class... Args>
+T* make_recycled(Args&&... args) {
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "over-aligned types are not supported");
+    void* mem = recycling_pool::allocate(sizeof(T));
+    try {
+        return new (mem) T(std::forward<Args>(args)...);
+    } catch (...) {
+        recycling_pool::deallocate(mem, sizeof(T));
+        throw;
+    }
+}
+
+// Standard allocator interface on top of the recycling_pool, e.g. for node-based containers.
+template <class T>
+struct recycling_allocator {
+    using value_type = T;
+
+    recycling_allocator() = default;
+    template <class U>
+    recycling_allocator(const recycling_allocator<U>&) {}
+
+    T* allocate(std::size_t n) {
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "over-aligned types are not supported");
+        return static_cast<T*>(recycling_pool::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) { recycling_pool::deallocate(p, n * sizeof(T)); }
+
+    template <class U>
+    friend bool operator==(const recycling_allocator&, const recycling_allocator<U>&) { return true; }
+    template <class U>
+    friend bool operator!=(const recycling_allocator&, const recycling_allocator<U>&) { return false; }
+};
+
+}}}
+
+#endif
@@ -0,0 +1,253 @@
+#ifndef _RETIRE_LIST_
+#define _RETIRE_LIST_
+
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "deletable_object.hpp"
+#include "port.hpp"
+
+namespace reclamation { namespace techniques { namespace utils {
+
+// A fixed size array of retired objects that are all reclaimed by the same reclaim function.
+// Chunks are linked to form a retire_list, so retiring an object does not have to touch the object itself.
+struct retire_chunk {
+    // capacity is chosen so that a chunk occupies exactly 1KiB on 64 bit platforms
+    static constexpr std::size_t capacity =
+        (1024 - sizeof(void*) - sizeof(std::size_t) - sizeof(reclaim_function)
+#ifdef EPOCH_BASED_TRACING
+         - sizeof(std::int64_t)
+#endif
+        ) / sizeof(void*);
+
+    retire_chunk* next = nullptr;
+    std::size_t count = 0;
+    reclaim_function reclaim = nullptr;
+#ifdef EPOCH_BASED_TRACING
+    // steady_clock time in ns at which the chunk was opened; tracing samples retire ages per chunk
+    std::int64_t retired_at = 0;
+#endif
+    void* objects[capacity];
+};
+
+// Per-thread cache of empty chunks, so that steady-state retiring does not allocate.
+class chunk_pool {
+public:
+    static constexpr std::size_t max_chunks = 16;
+
+    chunk_pool() = default;
+    chunk_pool(const chunk_pool&) = delete;
+    chunk_pool& operator=(const chunk_pool&) = delete;
+
+    ~chunk_pool() {
+        while (free_chunks)
+        {
+            auto next = free_chunks->next;
+            delete free_chunks;
+            free_chunks = next;
+        }
+    }
+
+    retire_chunk* get() {
+        if (free_chunks == nullptr)
+            return new retire_chunk();
+
+        auto result = free_chunks;
+        free_chunks = result->next;
+        --size;
+        result->next = nullptr;
+        result->count = 0;
+        result->reclaim = nullptr;
+        return result;
+    }
+
+    void put(retire_chunk* chunk) {
+        if (size == max_chunks)
+        {
+            delete chunk;
+            return;
+        }
+        chunk->next = free_chunks;
+        free_chunks = chunk;
+        ++size;
+    }
+
+    // Adds the chunks first..nullptr (linked via next) regardless of max_chunks; they were
+    // allocated for retiring already, so they are likely to be needed again.
+    void put_all(retire_chunk* first) {
+        while (first)
+        {
+            auto next = first->next;
+            first->next = free_chunks;
+            free_chunks = first;
+            ++size;
+            first = next;
+        }
+    }
+
+private:
+    retire_chunk* free_chunks = nullptr;
+    std::size_t size = 0;
+};
+
+// Deletes all objects in the chunks first..nullptr and returns the chunks to pool
+// (or frees them if pool is nullptr). The chain must not be reachable from any retire_list,
+// since destructors may retire further objects.
+inline void delete_objects(retire_chunk* first, chunk_pool* pool) {
+    while (first)
+    {
+        auto next = first->next;
+        first->reclaim(first->objects, first->count);
+
+        if (pool)
+            pool->put(first);
+        else
+            delete first;
+        first = next;
+    }
+}
+
+// A list of retired objects stored in chunks. Every chunk only holds objects with the same reclaim
+// function; the list keeps a few chunks open for pushing, so that interleaved retires of different
+// types still fill up their chunks. Whole lists can be appended to each other in O(1).
+class retire_list {
+public:
+    retire_list() = default;
+    retire_list(retire_chunk* first, retire_chunk* last) : first(first), last(last) {}
+    retire_list(const retire_list&) = delete;
+    retire_list& operator=(const retire_list&) = delete;
+
+    bool empty() const { return first == nullptr; }
+
+    // The chunk that pop() takes objects from, or nullptr if the list is empty.
+    const retire_chunk* front() const { return first; }
+
+    void push(void* p, reclaim_function reclaim, chunk_pool& pool) {
+        retire_chunk* chunk = nullptr;
+        for (auto c : open_chunks)
+            if (c != nullptr && c->reclaim == reclaim)
+            {
+                chunk = c;
+                break;
+            }
+
+        if (chunk == nullptr || chunk->count == retire_chunk::capacity)
+            chunk = open_chunk(reclaim, pool);
+        chunk->objects[chunk->count++] = p;
+    }
+
+    // Removes one object from the list. Returns {nullptr, nullptr} if the list is empty.
+    // A chunk that becomes empty is returned to pool.
+    std::pair<void*, reclaim_function> pop(chunk_pool& pool) {
+        if (first == nullptr)
+            return std::make_pair(nullptr, nullptr);
+
+        assert(first->count > 0);
+        auto result = std::make_pair(first->objects[--first->count], first->reclaim);
+        if (first->count == 0)
+        {
+            auto chunk = first;
+            first = chunk->next;
+            if (first == nullptr)
+                last = nullptr;
+            for (auto& c : open_chunks)
+                if (c == chunk)
+                    c = nullptr;
+            pool.put(chunk);
+        }
+        return result;
+    }
+
+    // Moves all objects from other to the end of this list.
+    void append(retire_list& other) {
+        if (other.first == nullptr)
+            return;
+        if (last == nullptr)
+            first = other.first;
+        else
+            last->next = other.first;
+        last = other.last;
+        other.first = other.last = nullptr;
+        other.open_chunks = {};
+    }
+
+    // Hands over the chunk chain to the caller and leaves the list empty.
+    std::pair<retire_chunk*, retire_chunk*> release() {
+        auto result = std::make_pair(first, last);
+        first = last = nullptr;
+        open_chunks = {};
+        return result;
+    }
+
+    // Deletes all objects in the list.
+    void delete_objects(chunk_pool* pool) {
+        auto chunks = release();
+        utils::delete_objects(chunks.first, pool);
+    }
+
+private:
+    static constexpr std::size_t max_open_chunks = 4;
+
+    retire_chunk* open_chunk(reclaim_function reclaim, chunk_pool& pool) {
+        auto chunk = pool.get();
+        chunk->reclaim = reclaim;
+#ifdef EPOCH_BASED_TRACING
+        chunk->retired_at = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+        chunk->next = first;
+        first = chunk;
+        if (last == nullptr)
+            last = chunk;
+
+        // replace a full chunk or one of the same type; otherwise evict in round-robin fashion
+        std::size_t slot = next_victim;
+        for (std::size_t i = 0; i < max_open_chunks; ++i)
+        {
+            auto c = open_chunks[i];
+            if (c == nullptr || c->reclaim == reclaim || c->count == retire_chunk::capacity)
+            {
+                slot = i;
+                break;
+            }
+        }
+        if (slot == next_victim)
+            next_victim = (next_victim + 1) % max_open_chunks;
+        open_chunks[slot] = chunk;
+        return chunk;
+    }
+
+    retire_chunk* first = nullptr;
+    retire_chunk* last = nullptr;
+    std::array<retire_chunk*, max_open_chunks> open_chunks = {};
+    std::size_t next_victim = 0;
+};
+
+// The retired nodes of a terminated thread, concatenated into a single list.
+// Adopting threads append the list to their own retire list for target_epoch; with monotonic
+// epochs it is the epoch of the most recently retired node.
+struct orphan
+{
+    const std::uint64_t target_epoch;
+    const std::size_t retired_objects;
+    const std::size_t retired_bytes;
+    retire_list nodes;
+    orphan* next = nullptr;
+
+    orphan(std::uint64_t target_epoch, retire_list& retired, std::size_t retired_objects, std::size_t retired_bytes):
+        target_epoch(target_epoch), retired_objects(retired_objects), retired_bytes(retired_bytes) {
+        nodes.append(retired);
+    }
+
+    ~orphan() {
+        nodes.delete_objects(nullptr);
+    }
+};
+
+}}}
+
+#endif
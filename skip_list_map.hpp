@@ -0,0 +1,435 @@
+#ifndef _SKIP_LIST_MAP_
+#define _SKIP_LIST_MAP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <utility>
+
+namespace reclamation {
+
+// Lock-free ordered map based on the skip list by Herlihy, Lev, Luchangco and Shavit.
+// A node is deleted by marking the next pointers of all its levels from the top down; the thread
+// that marks level 0 owns the deletion. Every operation runs in a single critical region of the
+// Reclaimer, so the traversals use plain loads instead of one guard_ptr per node.
+//
+// A node may still be linked into upper levels by its inserter while it is being deleted, so it
+// starts with two references - one for the inserter and one for the deleter - and whoever drops
+// the last one unlinks it from all levels and retires it through guard_ptr::reclaim.
+template <class Key, class Value, class Reclaimer, class Compare = std::less<Key>>
+class skip_list_map {
+    struct node;
+public:
+    static constexpr unsigned max_height = 24;
+
+    using value_type = std::pair<const Key, Value>;
+
+    class range;
+
+    skip_list_map() = default;
+    ~skip_list_map();
+
+    skip_list_map(const skip_list_map&) = delete;
+    skip_list_map& operator=(const skip_list_map&) = delete;
+
+    // Returns false if an equal key was already present; the map is not modified in that case.
+    bool insert(Key key, Value value);
+
+    // Returns false if no equal key was present.
+    bool erase(const Key& key);
+
+    // Copies the value of the entry with an equal key to result; returns false if there is none.
+    bool find(const Key& key, Value& result);
+
+    bool contains(const Key& key);
+
+    // All entries with keys in [from, to), in ascending order. The range holds a critical region
+    // until it is destroyed, so it should not be kept around longer than necessary.
+    range scan(const Key& from, const Key& to);
+
+private:
+    struct node_deleter {
+        void operator()(node* n) const {
+            n->~node();
+            ::operator delete(n);
+        }
+    };
+
+    using concurrent_ptr = typename Reclaimer::template concurrent_ptr<node, 1>;
+    using marked_ptr = typename concurrent_ptr::marked_ptr;
+    using guard_ptr = typename concurrent_ptr::guard_ptr;
+    using region_guard = typename Reclaimer::region_guard;
+
+    // The links of all levels are allocated right behind the node.
+    struct node : Reclaimer::template enable_concurrent_ptr<node, 1, node_deleter> {
+        node(unsigned height, Key&& key, Value&& value) :
+            item(std::move(key), std::move(value)),
+            height(height),
+            references(2)
+        {
+            for (unsigned i = 0; i < height; ++i)
+                new (&next()[i]) concurrent_ptr();
+        }
+
+        static constexpr std::size_t links_offset() {
+            return (sizeof(node) + alignof(concurrent_ptr) - 1) & ~(alignof(concurrent_ptr) - 1);
+        }
+
+        static node* create(unsigned height, Key&& key, Value&& value) {
+            void* memory = ::operator new(links_offset() + height * sizeof(concurrent_ptr));
+            return new (memory) node(height, std::move(key), std::move(value));
+        }
+
+        concurrent_ptr* next() {
+            return reinterpret_cast<concurrent_ptr*>(reinterpret_cast<char*>(this) + links_offset());
+        }
+
+        const Key& key() const { return item.first; }
+
+        value_type item;
+        const unsigned height;
+        std::atomic<unsigned> references;
+    };
+
+    concurrent_ptr& link(node* pred, unsigned level) {
+        return pred ? pred->next()[level] : head[level];
+    }
+
+    static unsigned random_height();
+
+    // Fills preds/succs with the position of key on every level, unlinking marked nodes on the
+    // way. Returns true if an unmarked node with an equal key is at succs[0].
+    bool find(const Key& key, concurrent_ptr** preds, marked_ptr* succs);
+
+    // Unlinks the deleted node n from all levels it has been linked into.
+    void unlink(node* n);
+
+    // Wait-free search for the first unmarked node with a key that is not less than key.
+    node* lower_bound(const Key& key);
+
+    void release_reference(node* n);
+
+    Compare compare;
+    concurrent_ptr head[max_height];
+};
+
+// Iteration does not help to unlink deleted nodes; it simply skips them.
+template <class Key, class Value, class Reclaimer, class Compare>
+class skip_list_map<Key, Value, Reclaimer, Compare>::range {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = skip_list_map::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        reference operator*() const { return current->item; }
+        pointer operator->() const { return &current->item; }
+
+        iterator& operator++() {
+            current = owner->next_in_range(current);
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator result = *this;
+            ++*this;
+            return result;
+        }
+
+        bool operator==(const iterator& other) const { return current == other.current; }
+        bool operator!=(const iterator& other) const { return current != other.current; }
+
+    private:
+        friend class range;
+        iterator(const range* owner, node* current) : owner(owner), current(current) {}
+
+        const range* owner;
+        node* current;
+    };
+
+    range(const range&) = delete;
+    range& operator=(const range&) = delete;
+
+    iterator begin() const { return iterator(this, first); }
+    iterator end() const { return iterator(this, nullptr); }
+
+private:
+    friend class skip_list_map;
+
+    range(skip_list_map& map, const Key& from, const Key& to) :
+        map(map),
+        to(to),
+        first(in_range(map.lower_bound(from)))
+    {}
+
+    node* in_range(node* n) const {
+        return n != nullptr && map.compare(n->key(), to) ? n : nullptr;
+    }
+
+    node* next_in_range(node* n) const {
+        do
+        {
+            // (1) - this acquire-load synchronizes-with the release-CAS (3, 4)
+            n = n->next()[0].load(std::memory_order_acquire).get();
+        } while (n != nullptr && n->next()[0].load(std::memory_order_relaxed).mark() != 0);
+        return in_range(n);
+    }
+
+    // entered before the first node is looked up and kept until the scan is done
+    region_guard critical_region;
+    skip_list_map& map;
+    const Key to;
+    node* const first;
+};
+
+template <class Key, class Value, class Reclaimer, class Compare>
+skip_list_map<Key, Value, Reclaimer, Compare>::~skip_list_map() {
+    // No concurrent accesses are allowed anymore, so the nodes can be deleted directly.
+    // Deleted nodes have been unlinked from all levels before they were retired.
+    node* n = head[0].load(std::memory_order_relaxed).get();
+    while (n)
+    {
+        node* next = n->next()[0].load(std::memory_order_relaxed).get();
+        node_deleter()(n);
+        n = next;
+    }
+}
+
+template <class Key, class Value, class Reclaimer, class Compare>
+unsigned skip_list_map<Key, Value, Reclaimer, Compare>::random_height() {
+    // xorshift; every level is half as likely as the one below.
+    static thread_local std::uint32_t state =
+        static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(&state) >> 4) | 1;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    unsigned height = 1;
+    for (auto bits = state; (bits & 1) != 0 && height < max_height; bits >>= 1)
+        ++height;
+    return height;
+}
+
+template <class Key, class Value, class Reclaimer, class Compare>
+bool skip_list_map<Key, Value, Reclaimer, Compare>::find(const Key& key, concurrent_ptr** preds, marked_ptr* succs) {
+retry:
+    node* pred = nullptr;
+    for (unsigned level = max_height; level-- > 0;)
+    {
+        // (2) - this acquire-load synchronizes-with the release-CAS (3, 4)
+        auto cur = link(pred, level).load(std::memory_order_acquire);
+        if (cur.mark() != 0)
+            goto retry; // pred has been deleted
+
+        while (cur)
+        {
+            auto next = cur->next()[level].load(std::memory_order_acquire);
+            if (next.mark() != 0)
+            {
+                // cur is deleted - try to unlink it on this level.
+                marked_ptr expected(cur.get());
+                if (!link(pred, level).compare_exchange_weak(expected, marked_ptr(next.get()),
+                        std::memory_order_release, std::memory_order_relaxed))
+                    goto retry;
+                cur = marked_ptr(next.get());
+                continue;
+            }
+
+            if (!compare(cur->key(), key))
+                break;
+            pred = cur.get();
+            cur = next;
+        }
+        preds[level] = &link(pred, level);
+        succs[level] = cur;
+    }
+    return succs[0] && !compare(key, succs[0]->key());
+}
+
+template <class Key, class Value, class Reclaimer, class Compare>
+void skip_list_map<Key, Value, Reclaimer, Compare>::unlink(node* n) {
+    // Unlike find, this also walks past nodes with an equal key, because on upper levels the
+    // inserter of n may have linked it behind a newer node with the same key.
+retry:
+    node* pred = nullptr;
+    for (unsigned level = max_height; level-- > 0;)
+    {
+        auto cur = link(pred, level).load(std::memory_order_acquire);
+        if (cur.mark() != 0)
+            goto retry;
+
+        // the last node with a smaller key is where the next level starts
+        node* less = pred;
+        node* local_pred = pred;
+        while (cur && !compare(n->key(), cur->key()))
+        {
+            auto next = cur->next()[level].load(std::memory_order_acquire);
+            if (next.mark() != 0)
+            {
+                marked_ptr expected(cur.get());
+                if (!link(local_pred, level).compare_exchange_weak(expected, marked_ptr(next.get()),
+                        std::memory_order_release, std::memory_order_relaxed))
+                    goto retry;
+                cur = marked_ptr(next.get());
+                continue;
+            }
+
+            if (compare(cur->key(), n->key()))
+                less = cur.get();
+            local_pred = cur.get();
+            cur = next;
+        }
+        pred = less;
+    }
+}
+
+template <class Key, class Value, class Reclaimer, class Compare>
+auto skip_list_map<Key, Value, Reclaimer, Compare>::lower_bound(const Key& key) -> node* {
+    node* pred = nullptr;
+    node* cur = nullptr;
+    for (unsigned level = max_height; level-- > 0;)
+    {
+        cur = link(pred, level).load(std::memory_order_acquire).get();
+        while (cur && compare(cur->key(), key))
+        {
+            pred = cur;
+            cur = cur->next()[level].load(std::memory_order_acquire).get();
+        }
+    }
+
+    while (cur && cur->next()[0].load(std::memory_order_relaxed).mark() != 0)
+        cur = cur->next()[0].load(std::memory_order_acquire).get();
+    return cur;
+}
+
+template <class Key, class Value, class Reclaimer, class Compare>
+void skip_list_map<Key, Value, Reclaimer, Compare>::release_reference(node* n) {
+    if (n->references.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return;
+
+    // Both the inserter and the deleter are done, so n cannot be linked again once it is unlinked.
+    unlink(n);
+    guard_ptr guard(marked_ptr(n, 0));
+    guard.reclaim();
+}
+
+template <class Key, class Value, class Reclaimer, class Compare>
+bool skip_list_map<Key, Value, Reclaimer, Compare>::insert(Key key, Value value) {
+    region_guard critical_region;
+    concurrent_ptr* preds[max_height];
+    marked_ptr succs[max_height];
+    node* n = nullptr;
+    for (;;)
+    {
+        // once the node exists, key has been moved into it
+        if (find(n == nullptr ? key : n->key(), preds, succs))
+        {
+            if (n != nullptr)
+                node_deleter()(n);
+            return false;
+        }
+
+        if (n == nullptr)
+            n = node::create(random_height(), std::move(key), std::move(value));
+        for (unsigned level = 0; level < n->height; ++level)
+            n->next()[level].store(succs[level], std::memory_order_relaxed);
+
+        marked_ptr expected = succs[0];
+        // (3) - this release-CAS synchronizes-with the acquire-loads (1, 2)
+        if (preds[0]->compare_exchange_weak(expected, marked_ptr(n, 0),
+                std::memory_order_release, std::memory_order_relaxed))
+            break;
+    }
+
+    // n is in the map now; link it into the upper levels until it is complete or deleted.
+    for (unsigned level = 1; level < n->height; ++level)
+    {
+        for (;;)
+        {
+            auto next = n->next()[level].load(std::memory_order_relaxed);
+            if (next.mark() != 0)
+                goto done;
+            if (next != succs[level] && !n->next()[level].compare_exchange_strong(next, succs[level],
+                    std::memory_order_relaxed, std::memory_order_relaxed))
+                goto done; // marked in the meantime
+
+            marked_ptr expected = succs[level];
+            // (4) - this release-CAS synchronizes-with the acquire-loads (1, 2)
+            if (preds[level]->compare_exchange_weak(expected, marked_ptr(n, 0),
+                    std::memory_order_release, std::memory_order_relaxed))
+                break;
+
+            if (!find(n->key(), preds, succs) || succs[0].get() != n)
+                goto done; // n has been deleted
+        }
+    }
+
+done:
+    release_reference(n);
+    return true;
+}
+
+template <class Key, class Value, class Reclaimer, class Compare>
+bool skip_list_map<Key, Value, Reclaimer, Compare>::erase(const Key& key) {
+    region_guard critical_region;
+    concurrent_ptr* preds[max_height];
+    marked_ptr succs[max_height];
+    for (;;)
+    {
+        if (!find(key, preds, succs))
+            return false;
+
+        node* n = succs[0].get();
+        for (unsigned level = n->height - 1; level > 0; --level)
+        {
+            auto next = n->next()[level].load(std::memory_order_relaxed);
+            while (next.mark() == 0 && !n->next()[level].compare_exchange_weak(next, marked_ptr(next.get(), 1),
+                    std::memory_order_relaxed, std::memory_order_relaxed))
+                ;
+        }
+
+        // Whoever marks level 0 has deleted the node.
+        auto next = n->next()[0].load(std::memory_order_relaxed);
+        while (next.mark() == 0)
+        {
+            if (n->next()[0].compare_exchange_weak(next, marked_ptr(next.get(), 1),
+                    std::memory_order_acq_rel, std::memory_order_relaxed))
+            {
+                find(key, preds, succs); // help to unlink n
+                release_reference(n);
+                return true;
+            }
+        }
+        // Another thread deleted n first; look again in case the key has been inserted anew.
+    }
+}
+
+template <class Key, class Value, class Reclaimer, class Compare>
+bool skip_list_map<Key, Value, Reclaimer, Compare>::find(const Key& key, Value& result) {
+    region_guard critical_region;
+    node* n = lower_bound(key);
+    if (n == nullptr || compare(key, n->key()))
+        return false;
+    result = n->item.second;
+    return true;
+}
+
+template <class Key, class Value, class Reclaimer, class Compare>
+bool skip_list_map<Key, Value, Reclaimer, Compare>::contains(const Key& key) {
+    region_guard critical_region;
+    node* n = lower_bound(key);
+    return n != nullptr && !compare(key, n->key());
+}
+
+template <class Key, class Value, class Reclaimer, class Compare>
+auto skip_list_map<Key, Value, Reclaimer, Compare>::scan(const Key& from, const Key& to) -> range {
+    return range(*this, from, to);
+}
+}
+
+#endif
@@ -0,0 +1,368 @@
+#ifndef _SPLIT_ORDERED_HASH_MAP_
+#define _SPLIT_ORDERED_HASH_MAP_
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace reclamation {
+
+// Lock-free resizable hash map based on Shalev and Shavit's split-ordered lists.
+// All entries live in a single Harris-Michael list sorted by their bit-reversed hash; buckets
+// are dummy nodes in that list that are created lazily, so growing the table never moves an
+// entry. Erased entries and replaced bucket arrays are retired through the Reclaimer.
+template <class Key, class Value, class Reclaimer, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>>
+class split_ordered_hash_map {
+public:
+    explicit split_ordered_hash_map(std::size_t initial_buckets = 16, std::size_t max_load_factor = 2);
+    ~split_ordered_hash_map();
+
+    split_ordered_hash_map(const split_ordered_hash_map&) = delete;
+    split_ordered_hash_map& operator=(const split_ordered_hash_map&) = delete;
+
+    // Returns false if an equal key was already present; the map is not modified in that case.
+    bool insert(Key key, Value value);
+
+    // Returns false if no equal key was present.
+    bool erase(const Key& key);
+
+    // Copies the value of the entry with an equal key to result; returns false if there is none.
+    bool find(const Key& key, Value& result);
+
+    bool contains(const Key& key);
+
+    // Number of entries; only a snapshot if there are concurrent modifications.
+    std::size_t size() const { return item_count.load(std::memory_order_relaxed); }
+
+    std::size_t bucket_count();
+
+private:
+    struct node;
+    struct bucket_array;
+    using concurrent_ptr = typename Reclaimer::template concurrent_ptr<node, 1>;
+    using marked_ptr = typename concurrent_ptr::marked_ptr;
+    using guard_ptr = typename concurrent_ptr::guard_ptr;
+    using table_ptr = typename Reclaimer::template concurrent_ptr<bucket_array, 0>;
+    using table_guard = typename table_ptr::guard_ptr;
+    using region_guard = typename Reclaimer::region_guard;
+
+    // Regular nodes have the lowest bit of their split-order key set, dummy nodes do not.
+    struct node : Reclaimer::template enable_concurrent_ptr<node, 1> {
+        explicit node(std::size_t split_key) : split_key(split_key) {}
+        node(std::size_t split_key, Key&& key, Value&& value) : split_key(split_key) {
+            new (&item) std::pair<const Key, Value>(std::move(key), std::move(value));
+        }
+        ~node() {
+            if (!is_dummy())
+                item.~pair();
+        }
+
+        bool is_dummy() const { return (split_key & 1) == 0; }
+
+        const std::size_t split_key;
+        union { std::pair<const Key, Value> item; };
+        concurrent_ptr next;
+    };
+
+    // Each bucket points to its dummy node once that has been created. Dummy nodes are never
+    // removed, so a grown array can simply copy the pointers of the old one.
+    struct bucket_array : Reclaimer::template enable_concurrent_ptr<bucket_array> {
+        explicit bucket_array(std::size_t size) : size(size), buckets(new concurrent_ptr[size]) {}
+
+        const std::size_t size;
+        std::unique_ptr<concurrent_ptr[]> buckets;
+    };
+
+    // Position found by find: prev points to the link that contains cur,
+    // save protects the node that owns prev.
+    struct find_info {
+        concurrent_ptr* prev;
+        marked_ptr next;
+        guard_ptr cur;
+        guard_ptr save;
+    };
+
+    static std::size_t reverse_bits(std::size_t v);
+    static std::size_t regular_key(std::size_t hash) { return reverse_bits(hash) | 1; }
+    static std::size_t dummy_key(std::size_t bucket) { return reverse_bits(bucket); }
+
+    // Searches the list starting at start for a node with the given split-order key (and, for
+    // regular nodes, an equal key), unlinking marked nodes on the way. On return cur is either
+    // that node or the first node with a larger split-order key.
+    bool find(concurrent_ptr& start, std::size_t split_key, const Key* key, find_info& info);
+
+    // Returns the dummy node of the bucket for hash, creating it if necessary.
+    node* get_bucket(std::size_t hash, table_guard& table);
+    node* initialize_bucket(bucket_array& table, std::size_t bucket);
+
+    void grow(table_guard& table);
+
+    Hash hasher;
+    KeyEqual key_equal;
+    const std::size_t max_load_factor;
+    node* const root;
+    table_ptr table;
+    alignas(64) std::atomic<std::size_t> item_count;
+};
+
+template <class Key, class Value, class Reclaimer, class Hash, class KeyEqual>
+split_ordered_hash_map<Key, Value, Reclaimer, Hash, KeyEqual>::split_ordered_hash_map(
+    std::size_t initial_buckets, std::size_t max_load_factor) :
+    max_load_factor(max_load_factor),
+    root(new node(0)),
+    item_count(0)
+{
+    assert(initial_buckets > 0 && (initial_buckets & (initial_buckets - 1)) == 0 &&
+        "the number of buckets must be a power of two");
+    auto t = new bucket_array(initial_buckets);
+    t->buckets[0].store(root, std::memory_order_relaxed);
+    table.store(t, std::memory_order_relaxed);
+}
+
+template <class Key, class Value, class Reclaimer, class Hash, class KeyEqual>
+split_ordered_hash_map<Key, Value, Reclaimer, Hash, KeyEqual>::~split_ordered_hash_map() {
+    // No concurrent accesses are allowed anymore, so everything can be deleted directly.
+    marked_ptr n = root;
+    while (n)
+    {
+        auto next = n->next.load(std::memory_order_relaxed);
+        delete n.get();
+        n = next;
+    }
+    delete table.load(std::memory_order_relaxed).get();
+}
+
+template <class Key, class Value, class Reclaimer, class Hash, class KeyEqual>
+std::size_t split_ordered_hash_map<Key, Value, Reclaimer, Hash, KeyEqual>::reverse_bits(std::size_t v) {
+    std::size_t mask = ~std::size_t(0);
+    for (unsigned shift = sizeof(std::size_t) * 4; shift > 0; shift >>= 1)
+    {
+        mask ^= mask << shift;
+        v = ((v >> shift) & mask) | ((v << shift) & ~mask);
+    }
+    return v;
+}
+
+template <class Key, class Value, class Reclaimer, class Hash, class KeyEqual>
+bool split_ordered_hash_map<Key, Value, Reclaimer, Hash, KeyEqual>::find(
+    concurrent_ptr& start, std::size_t split_key, const Key* key, find_info& info)
+{
+retry:
+    info.prev = &start;
+    info.next = info.prev->load(std::memory_order_relaxed);
+    info.save.reset();
+    for (;;)
+    {
+        // (1) - this acquire-load synchronizes-with the release-CAS (2, 3, 4)
+        if (!info.cur.acquire_if_equal(*info.prev, info.next, std::memory_order_acquire))
+            goto retry;
+
+        if (!info.cur)
+            return false;
+
+        info.next = info.cur->next.load(std::memory_order_relaxed);
+        if (info.next.mark() != 0)
+        {
+            // cur is logically deleted - try to unlink it.
+            info.next = marked_ptr(info.next.get(), 0);
+            marked_ptr expected(info.cur.get());
+            // (2) - this release-CAS synchronizes-with the acquire-load (1)
+            if (!info.prev->compare_exchange_weak(expected, info.next,
+                    std::memory_order_release, std::memory_order_relaxed))
+                goto retry;
+            info.cur.reclaim();
+        }
+        else
+        {
+            if (info.prev->load(std::memory_order_relaxed) != info.cur.get())
+                goto retry;
+
+            const auto ckey = info.cur->split_key;
+            if (ckey > split_key)
+                return false;
+            if (ckey == split_key && (key == nullptr || key_equal(info.cur->item.first, *key)))
+                return true;
+
+            info.prev = &info.cur->next;
+            std::swap(info.save, info.cur);
+        }
+    }
+}
+
+template <class Key, class Value, class Reclaimer, class Hash, class KeyEqual>
+auto split_ordered_hash_map<Key, Value, Reclaimer, Hash, KeyEqual>::initialize_bucket(
+    bucket_array& t, std::size_t bucket) -> node*
+{
+    // The parent bucket is the bucket index with its most significant bit cleared.
+    std::size_t parent = bucket;
+    for (std::size_t bit = bucket; bit != 0; bit &= bit - 1)
+        parent = bit;
+    parent = bucket & ~parent;
+
+    node* parent_dummy = t.buckets[parent].load(std::memory_order_acquire).get();
+    if (parent_dummy == nullptr)
+        parent_dummy = initialize_bucket(t, parent);
+
+    const auto split_key = dummy_key(bucket);
+    node* dummy = nullptr;
+    find_info info;
+    for (;;)
+    {
+        if (find(parent_dummy->next, split_key, nullptr, info))
+        {
+            // Another thread was faster.
+            delete dummy;
+            dummy = info.cur.get();
+            break;
+        }
+
+        if (dummy == nullptr)
+            dummy = new node(split_key);
+        dummy->next.store(marked_ptr(info.cur.get()), std::memory_order_relaxed);
+
+        marked_ptr expected(info.cur.get());
+        // (3) - this release-CAS synchronizes-with the acquire-load (1, 5)
+        if (info.prev->compare_exchange_weak(expected, dummy, std::memory_order_release, std::memory_order_relaxed))
+            break;
+    }
+
+    t.buckets[bucket].store(dummy, std::memory_order_release);
+    return dummy;
+}
+
+template <class Key, class Value, class Reclaimer, class Hash, class KeyEqual>
+auto split_ordered_hash_map<Key, Value, Reclaimer, Hash, KeyEqual>::get_bucket(
+    std::size_t hash, table_guard& t) -> node*
+{
+    // (5) - this acquire-load synchronizes-with the release-CAS (6)
+    t.acquire(table, std::memory_order_acquire);
+    const auto bucket = hash & (t->size - 1);
+    node* dummy = t->buckets[bucket].load(std::memory_order_acquire).get();
+    if (dummy == nullptr)
+        dummy = initialize_bucket(*t, bucket);
+    return dummy;
+}
+
+template <class Key, class Value, class Reclaimer, class Hash, class KeyEqual>
+void split_ordered_hash_map<Key, Value, Reclaimer, Hash, KeyEqual>::grow(table_guard& t) {
+    auto old_size = t->size;
+    auto grown = new bucket_array(old_size * 2);
+    for (std::size_t i = 0; i < old_size; ++i)
+        grown->buckets[i].store(t->buckets[i].load(std::memory_order_acquire), std::memory_order_relaxed);
+
+    // Buckets that are initialized in the old array after they have been copied are found
+    // again in the list by initialize_bucket, so nothing is lost.
+    typename table_ptr::marked_ptr expected(t.get());
+    // (6) - this release-CAS synchronizes-with the acquire-load (5)
+    if (table.compare_exchange_strong(expected, grown, std::memory_order_release, std::memory_order_relaxed))
+        t.reclaim();
+    else
+        delete grown;
+}
+
+template <class Key, class Value, class Reclaimer, class Hash, class KeyEqual>
+bool split_ordered_hash_map<Key, Value, Reclaimer, Hash, KeyEqual>::insert(Key key, Value value) {
+    region_guard critical_region;
+    const auto hash = hasher(key);
+    const auto split_key = regular_key(hash);
+    table_guard t;
+    node* bucket = get_bucket(hash, t);
+
+    node* n = nullptr;
+    find_info info;
+    for (;;)
+    {
+        // once the node exists, key has been moved into it
+        if (find(bucket->next, split_key, n == nullptr ? &key : &n->item.first, info))
+        {
+            delete n;
+            return false;
+        }
+
+        if (n == nullptr)
+            n = new node(split_key, std::move(key), std::move(value));
+        n->next.store(marked_ptr(info.cur.get()), std::memory_order_relaxed);
+
+        marked_ptr expected(info.cur.get());
+        // (4) - this release-CAS synchronizes-with the acquire-load (1)
+        if (info.prev->compare_exchange_weak(expected, n, std::memory_order_release, std::memory_order_relaxed))
+            break;
+    }
+
+    const auto count = item_count.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (count > t->size * max_load_factor)
+        grow(t);
+    return true;
+}
+
+template <class Key, class Value, class Reclaimer, class Hash, class KeyEqual>
+bool split_ordered_hash_map<Key, Value, Reclaimer, Hash, KeyEqual>::erase(const Key& key) {
+    region_guard critical_region;
+    const auto hash = hasher(key);
+    const auto split_key = regular_key(hash);
+    table_guard t;
+    node* bucket = get_bucket(hash, t);
+
+    find_info info;
+    for (;;)
+    {
+        if (!find(bucket->next, split_key, &key, info))
+            return false;
+
+        // Logically delete cur by marking its next pointer.
+        auto next = info.next;
+        if (info.cur->next.compare_exchange_weak(next, marked_ptr(next.get(), 1),
+                std::memory_order_acquire, std::memory_order_relaxed))
+            break;
+    }
+
+    item_count.fetch_sub(1, std::memory_order_relaxed);
+    marked_ptr expected(info.cur.get());
+    if (info.prev->compare_exchange_weak(expected, info.next, std::memory_order_release, std::memory_order_relaxed))
+        info.cur.reclaim();
+    else
+        find(bucket->next, split_key, &key, info); // let find unlink the marked node
+
+    return true;
+}
+
+template <class Key, class Value, class Reclaimer, class Hash, class KeyEqual>
+bool split_ordered_hash_map<Key, Value, Reclaimer, Hash, KeyEqual>::find(const Key& key, Value& result) {
+    region_guard critical_region;
+    const auto hash = hasher(key);
+    table_guard t;
+    node* bucket = get_bucket(hash, t);
+
+    find_info info;
+    if (!find(bucket->next, regular_key(hash), &key, info))
+        return false;
+    result = info.cur->item.second;
+    return true;
+}
+
+template <class Key, class Value, class Reclaimer, class Hash, class KeyEqual>
+bool split_ordered_hash_map<Key, Value, Reclaimer, Hash, KeyEqual>::contains(const Key& key) {
+    region_guard critical_region;
+    const auto hash = hasher(key);
+    table_guard t;
+    node* bucket = get_bucket(hash, t);
+
+    find_info info;
+    return find(bucket->next, regular_key(hash), &key, info);
+}
+
+template <class Key, class Value, class Reclaimer, class Hash, class KeyEqual>
+std::size_t split_ordered_hash_map<Key, Value, Reclaimer, Hash, KeyEqual>::bucket_count() {
+    region_guard critical_region;
+    table_guard t;
+    t.acquire(table, std::memory_order_acquire);
+    return t->size;
+}
+}
+
+#endif
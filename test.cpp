@@ -1,5 +1,16 @@
 #include "epoch_based.hpp"
+#include "harris_michael_list_based_set.hpp"
+#include "michael_scott_queue.hpp"
+#include "quiescent_state_based.hpp"
+#include "skip_list_map.hpp"
+#include "split_ordered_hash_map.hpp"
+#include <algorithm>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 using Reclaimer = reclamation::techniques::epoch_based<0>;
 
@@ -29,6 +40,63 @@ void MyDeleter::operator()(FooWithCustomDeleter* obj) {
     std::cout << "Custom deleter called.\n";
 }
 
+// Bar has an empty deleter, so it is reclaimed without virtual dispatch and needs no vtable.
+struct Bar : Reclaimer::enable_concurrent_ptr<Bar>
+{
+    static int instances;
+    Bar() { ++instances; }
+    ~Bar() { --instances; }
+};
+int Bar::instances = 0;
+
+#ifndef TRACK_ALLOCATIONS
+static_assert(!std::is_polymorphic<Bar>::value, "objects with empty deleters should not have a vtable");
+#endif
+
+// Baz is allocated from and reclaimed into the per-thread recycling pool.
+struct Baz : Reclaimer::enable_concurrent_ptr<Baz, 0, reclamation::techniques::utils::recycling_deleter<Baz>>
+{
+    int value = 0;
+};
+
+// Quux counts its instances atomically, as it may be reclaimed by any thread.
+struct Quux : Reclaimer::enable_concurrent_ptr<Quux>
+{
+    static std::atomic<int> instances;
+    Quux() { ++instances; }
+    ~Quux() { --instances; }
+};
+std::atomic<int> Quux::instances(0);
+
+// Cold lives in a reclamation domain of its own.
+struct cold_domain {};
+using ColdReclaimer = reclamation::techniques::epoch_based<0, cold_domain>;
+
+struct Cold : ColdReclaimer::enable_concurrent_ptr<Cold>
+{
+    static std::atomic<int> instances;
+    Cold() { ++instances; }
+    ~Cold() { --instances; }
+};
+std::atomic<int> Cold::instances(0);
+
+using QSBR = reclamation::techniques::quiescent_state_based<0>;
+
+struct Qux : QSBR::enable_concurrent_ptr<Qux>
+{
+    static std::atomic<int> instances;
+    Qux() { ++instances; }
+    ~Qux() { --instances; }
+};
+std::atomic<int> Qux::instances(0);
+
+// Keys too long for the small string optimization, so that a moved-from key is really empty.
+// Zero padding makes their order match the order of k.
+std::string string_key(int k) {
+    auto digits = std::to_string(k);
+    return std::string(40 - digits.size(), '0') + digits;
+}
+
 struct EpochBasedTest {
     Foo* foo = new Foo(&foo);
     marked_ptr<Foo> mp = marked_ptr<Foo>(foo, 3);
@@ -136,6 +204,1096 @@ struct EpochBasedTest {
         wrap_around_epochs();
     }
 
+    // a region_guard held by another thread blocks reclamation until it is released, and
+    // guard_ptrs created inside a region only nest instead of entering it again
+    void test11() {
+        std::atomic<int> step(0);
+        std::thread reader([&]() {
+            Reclaimer::region_guard rg;
+            step = 1;
+            while (step != 2)
+                std::this_thread::yield();
+        });
+        while (step != 1)
+            std::this_thread::yield();
+
+        {
+            concurrent_ptr<Foo>::guard_ptr gp(mp);
+            gp.reclaim();
+            this->mp = nullptr;
+        }
+        for (int i = 0; i < 10; ++i)
+            update_epoch();
+        assert(foo != nullptr);
+
+        step = 2;
+        reader.join();
+        wrap_around_epochs();
+        assert(foo == nullptr);
+
+        {
+            Reclaimer::region_guard rg;
+            const auto advances = Reclaimer::snapshot().total.epoch_advances;
+            for (int i = 0; i < 10; ++i)
+                update_epoch();
+            assert(Reclaimer::snapshot().total.epoch_advances == advances);
+        }
+    }
+
+    // reaching a retire limit forces epoch updates, so the object gets reclaimed as soon as
+    // the thread leaves its critical region
+    void test12() {
+        Reclaimer::set_retire_limits({1, 0, 0, 0});
+        {
+            concurrent_ptr<Foo>::guard_ptr gp(mp);
+            this->mp = nullptr;
+            gp.reclaim();
+        }
+        assert(foo == nullptr);
+        Reclaimer::set_retire_limits({});
+    }
+
+    // if a thread in its critical region prevents the forced epoch updates, the retire limit handler is called
+    void test13() {
+        static bool reported;
+        reported = false;
+        Reclaimer::set_retire_limits({1, 0, 0, 0});
+        Reclaimer::set_retire_limit_handler([](const Reclaimer::retire_limit_report& report) {
+            assert(report.blocked_by_reader);
+            assert(report.thread_objects == 1);
+            reported = true;
+        });
+
+        std::atomic<int> stage(0);
+        std::thread reader([&stage]() {
+            Reclaimer::region_guard rg;
+            stage = 1;
+            while (stage != 2)
+                std::this_thread::yield();
+        });
+        while (stage != 1)
+            std::this_thread::yield();
+
+        {
+            concurrent_ptr<Foo>::guard_ptr gp(mp);
+            this->mp = nullptr;
+            gp.reclaim();
+        }
+        assert(reported);
+        assert(foo != nullptr);
+
+        stage = 2;
+        reader.join();
+        Reclaimer::set_retire_limits({});
+        Reclaimer::set_retire_limit_handler(nullptr);
+        wrap_around_epochs();
+        assert(foo == nullptr);
+    }
+
+    // with the reclamation service running, expired objects are reclaimed by a background thread,
+    // and the chunks it empties are reused for later retire lists
+    void test14() {
+        Reclaimer::start_reclamation_service();
+        {
+            concurrent_ptr<Foo>::guard_ptr gp(mp);
+            this->mp = nullptr;
+            gp.reclaim();
+        }
+        for (int i = 0; i < 2000; ++i)
+        {
+            concurrent_ptr<Quux>::guard_ptr guard(new Quux());
+            guard.reclaim();
+            if (i % 100 == 0)
+                update_epoch();
+        }
+        wrap_around_epochs();
+        Reclaimer::stop_reclamation_service();
+        assert(foo == nullptr);
+        assert(Quux::instances == 0);
+    }
+
+    // with a reclamation budget of one object, every critical region entry deletes at most one expired object
+    void test15() {
+        Reclaimer::set_reclamation_budget(1);
+        Foo* foo2 = new Foo(&foo2);
+        {
+            concurrent_ptr<Foo>::guard_ptr gp(mp);
+            concurrent_ptr<Foo>::guard_ptr gp2(foo2);
+            this->mp = nullptr;
+            gp.reclaim();
+            gp2.reclaim();
+        }
+        for (int i = 0; i < 3 && foo != nullptr && foo2 != nullptr; ++i)
+            update_epoch();
+        assert((foo == nullptr) != (foo2 == nullptr));
+        update_epoch();
+        assert(foo == nullptr && foo2 == nullptr);
+        Reclaimer::set_reclamation_budget(0);
+    }
+
+    // retire lists spanning several chunks get reclaimed completely
+    void test16() {
+        std::vector<Foo*> foos(1000);
+        {
+            Reclaimer::region_guard rg;
+            for (auto& f : foos)
+            {
+                f = new Foo(&f);
+                concurrent_ptr<Foo>::guard_ptr gp(f);
+                gp.reclaim();
+            }
+        }
+        wrap_around_epochs();
+        assert(std::all_of(foos.begin(), foos.end(), [](Foo* f) { return f == nullptr; }));
+    }
+
+    // objects of different types retired in an interleaved fashion are all reclaimed
+    void test17() {
+        std::vector<Foo*> foos(500);
+        {
+            Reclaimer::region_guard rg;
+            for (auto& f : foos)
+            {
+                f = new Foo(&f);
+                concurrent_ptr<Foo>::guard_ptr gp(f);
+                gp.reclaim();
+                concurrent_ptr<Bar>::guard_ptr gp2(new Bar());
+                gp2.reclaim();
+            }
+        }
+        assert(Bar::instances == 500);
+        wrap_around_epochs();
+        assert(std::all_of(foos.begin(), foos.end(), [](Foo* f) { return f == nullptr; }));
+        assert(Bar::instances == 0);
+    }
+
+    // reclaimed objects with a recycling_deleter go back to the thread's pool and are reused by the next allocation
+    void test18() {
+        using reclamation::techniques::utils::recycling_pool;
+        using reclamation::techniques::utils::make_recycled;
+        recycling_pool::release_memory();
+
+        Baz* baz = make_recycled<Baz>();
+        {
+            concurrent_ptr<Baz>::guard_ptr gp(baz);
+            gp.reclaim();
+        }
+        wrap_around_epochs();
+        assert(recycling_pool::cached_blocks(sizeof(Baz)) == 1);
+
+        Baz* baz2 = make_recycled<Baz>();
+        assert(baz2 == baz);
+        assert(recycling_pool::cached_blocks(sizeof(Baz)) == 0);
+        reclamation::techniques::utils::recycling_deleter<Baz>{}(baz2);
+
+        recycling_pool::release_memory();
+        assert(recycling_pool::cached_blocks(sizeof(Baz)) == 0);
+
+        // the thread's pool is created after its reclamation state and therefore destroyed first,
+        // so the objects reclaimed while the thread exits must bypass it
+        Reclaimer::set_reclamation_budget(1);
+        std::thread([this]() {
+            update_epoch();
+            {
+                Reclaimer::region_guard region;
+                for (int i = 0; i < 10; ++i)
+                {
+                    concurrent_ptr<Baz>::guard_ptr gp(make_recycled<Baz>());
+                    gp.reclaim();
+                }
+            }
+            wrap_around_epochs();
+        }).join();
+        Reclaimer::set_reclamation_budget(0);
+    }
+
+    // concurrent producers and consumers lose no element and keep each producer's order
+    void test19() {
+        constexpr int producers = 2, consumers = 2, count = 20000;
+        reclamation::michael_scott_queue<int, Reclaimer> queue;
+        std::atomic<int> popped(0);
+        std::atomic<long long> sum(0);
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; ++p)
+            threads.emplace_back([&queue, p]() {
+                for (int i = 0; i < count; ++i)
+                    queue.push(p * count + i);
+            });
+        for (int c = 0; c < consumers; ++c)
+            threads.emplace_back([&]() {
+                int last[producers];
+                std::fill(last, last + producers, -1);
+                while (popped.load() < producers * count)
+                {
+                    int v;
+                    if (!queue.try_pop(v))
+                        continue;
+                    assert(v % count > last[v / count]);
+                    last[v / count] = v % count;
+                    sum += v;
+                    ++popped;
+                }
+            });
+        for (auto& t : threads)
+            t.join();
+
+        int v;
+        assert(!queue.try_pop(v));
+        long long n = producers * count;
+        assert(sum == n * (n - 1) / 2);
+    }
+
+    // concurrent inserts and erases on overlapping key ranges leave a consistent set
+    void test20() {
+        constexpr int threads_count = 4, keys = 256, rounds = 20;
+        reclamation::harris_michael_list_based_set<int, Reclaimer> set;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threads_count; ++t)
+            threads.emplace_back([&set, t]() {
+                for (int r = 0; r < rounds; ++r)
+                {
+                    for (int k = t; k < keys; k += 2)
+                        set.insert(k);
+                    for (int k = t; k < keys; k += 2)
+                        if (k % 4 >= 2)
+                            set.erase(k);
+                }
+            });
+        for (auto& t : threads)
+            t.join();
+
+        for (int k = 0; k < keys; ++k)
+            assert(set.contains(k) == (k % 4 < 2));
+        assert(!set.insert(0));
+        assert(set.erase(0));
+        assert(!set.contains(0));
+        assert(!set.erase(0));
+    }
+
+    // the hash map grows while threads insert and erase disjoint key ranges
+    void test21() {
+        constexpr int threads_count = 4, keys = 2000;
+        reclamation::split_ordered_hash_map<int, int, Reclaimer> map(2);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threads_count; ++t)
+            threads.emplace_back([&map, t]() {
+                for (int k = t * keys; k < (t + 1) * keys; ++k)
+                    assert(map.insert(k, -k));
+                for (int k = t * keys + 1; k < (t + 1) * keys; k += 2)
+                    assert(map.erase(k));
+            });
+        for (auto& t : threads)
+            t.join();
+
+        assert(map.size() == threads_count * keys / 2);
+        assert(map.bucket_count() >= map.size() / 2);
+        for (int k = 0; k < threads_count * keys; ++k)
+        {
+            int value = 0;
+            assert(map.find(k, value) == (k % 2 == 0));
+            assert(k % 2 != 0 || value == -k);
+        }
+        assert(!map.insert(0, 1));
+        assert(map.erase(0));
+        assert(!map.contains(0));
+        assert(map.insert(0, 1));
+    }
+
+    // range scans stay sorted and see every stable key while other threads insert and erase
+    void test22() {
+        constexpr int keys = 4000, writers = 2, rounds = 5;
+        reclamation::skip_list_map<int, int, Reclaimer> map;
+        for (int k = 0; k < keys; k += 2)
+            assert(map.insert(k, -k));
+        assert(!map.insert(0, 1));
+
+        std::atomic<bool> done(false);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < writers; ++t)
+            threads.emplace_back([&map, t]() {
+                for (int r = 0; r < rounds; ++r)
+                {
+                    for (int k = 1 + 2 * t; k < keys; k += 2 * writers)
+                        assert(map.insert(k, -k));
+                    for (int k = 1 + 2 * t; k < keys; k += 2 * writers)
+                        assert(map.erase(k));
+                }
+            });
+        threads.emplace_back([&map, &done]() {
+            while (!done.load())
+            {
+                int count = 0, last = -1;
+                for (auto& entry : map.scan(100, 300))
+                {
+                    assert(entry.first > last && entry.first >= 100 && entry.first < 300);
+                    assert(entry.second == -entry.first);
+                    last = entry.first;
+                    count += entry.first % 2 == 0;
+                }
+                assert(count == 100);
+            }
+        });
+        for (int t = 0; t < writers; ++t)
+            threads[t].join();
+        done = true;
+        threads.back().join();
+
+        int value = 0;
+        assert(map.find(10, value) && value == -10);
+        assert(!map.contains(11));
+        assert(map.erase(10));
+        assert(!map.erase(10));
+        assert(!map.find(10, value));
+        int count = 0;
+        for (auto& entry : map.scan(0, keys))
+            count += entry.first == 10 ? 100 : 1;
+        assert(count == keys / 2 - 1);
+    }
+
+    // with QSBR, a retired object is reclaimed only after every thread passed a quiescent state,
+    // and objects retired by an exiting thread are adopted by the others; guards are acquired
+    // inside region_guards, which register the threads
+    void test23() {
+        QSBR::concurrent_ptr<Qux> root(new Qux());
+        std::atomic<int> step(0);
+        std::thread reader([&]() {
+            {
+                QSBR::region_guard region;
+                QSBR::concurrent_ptr<Qux>::guard_ptr guard;
+                guard.acquire(root);
+                step = 1;
+                while (step != 2)
+                    std::this_thread::yield();
+            }
+            while (step != 3)
+            {
+                QSBR::quiescent_state();
+                std::this_thread::yield();
+            }
+        });
+        while (step != 1)
+            std::this_thread::yield();
+
+        {
+            QSBR::region_guard region;
+            auto guard = reclamation::acquire_guard(root);
+            root.store(nullptr);
+            guard.reclaim();
+        }
+        for (int i = 0; i < 10; ++i)
+            QSBR::quiescent_state();
+        assert(Qux::instances == 1);
+
+        step = 2;
+        for (int i = 0; i < 100000 && Qux::instances != 0; ++i)
+        {
+            QSBR::quiescent_state();
+            std::this_thread::yield();
+        }
+        assert(Qux::instances == 0);
+        step = 3;
+        reader.join();
+
+        std::thread([]() {
+            QSBR::concurrent_ptr<Qux>::guard_ptr guard(new Qux());
+            guard.reclaim();
+        }).join();
+        assert(Qux::instances == 1);
+        for (int i = 0; i < 10; ++i)
+            QSBR::quiescent_state();
+        assert(Qux::instances == 0);
+    }
+
+    // the data structures work unchanged on top of QSBR
+    void test24() {
+        constexpr int threads_count = 4, count = 10000;
+        reclamation::michael_scott_queue<int, QSBR> queue;
+        std::atomic<long long> sum(0);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threads_count; ++t)
+            threads.emplace_back([&queue, &sum]() {
+                for (int i = 0; i < count; ++i)
+                {
+                    queue.push(i);
+                    int v;
+                    if (queue.try_pop(v))
+                        sum += v;
+                    QSBR::quiescent_state();
+                }
+            });
+        for (auto& t : threads)
+            t.join();
+
+        int v;
+        while (queue.try_pop(v))
+            sum += v;
+        assert(sum == threads_count * (long long)count * (count - 1) / 2);
+        for (int i = 0; i < 10; ++i)
+            QSBR::quiescent_state();
+    }
+
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+    // a stalled reader is ejected once the epoch could not be updated twice; the object it
+    // guards survives while everything else gets reclaimed. A reader in a region_guard is
+    // never ejected.
+    void test25() {
+        Reclaimer::set_hazard_fallback(2);
+        concurrent_ptr<Quux> first(new Quux()), second(new Quux());
+        std::atomic<int> step(0);
+        std::thread reader([&]() {
+            concurrent_ptr<Quux>::guard_ptr guard;
+            guard.acquire(first);
+            step = 1;
+            while (step != 2)
+                std::this_thread::yield();
+            guard.reset();
+        });
+        while (step != 1)
+            std::this_thread::yield();
+
+        const auto ejected = Reclaimer::ejected_readers();
+        for (auto p : {&first, &second})
+        {
+            auto guard = reclamation::acquire_guard(*p);
+            p->store(nullptr);
+            guard.reclaim();
+        }
+        for (int i = 0; i < 4; ++i)
+            wrap_around_epochs();
+        assert(Reclaimer::ejected_readers() > ejected);
+        assert(Quux::instances == 1);
+
+        step = 2;
+        reader.join();
+        for (int i = 0; i < 4; ++i)
+            wrap_around_epochs();
+        assert(Quux::instances == 0);
+
+        step = 0;
+        std::thread pinned_reader([&]() {
+            Reclaimer::region_guard region;
+            step = 1;
+            while (step != 2)
+                std::this_thread::yield();
+        });
+        while (step != 1)
+            std::this_thread::yield();
+
+        {
+            concurrent_ptr<Quux>::guard_ptr guard(new Quux());
+            guard.reclaim();
+        }
+        for (int i = 0; i < 4; ++i)
+            wrap_around_epochs();
+        assert(Reclaimer::ejected_readers() == ejected + 1);
+        assert(Quux::instances == 1);
+
+        step = 2;
+        pinned_reader.join();
+        for (int i = 0; i < 4; ++i)
+            wrap_around_epochs();
+        assert(Quux::instances == 0);
+        Reclaimer::set_hazard_fallback(0);
+    }
+#endif
+
+    // with an epoch advance step, a thread checks one other thread per entry; the epoch
+    // still cannot advance past a reader, but advances once the cursor has passed everyone
+    void test26() {
+        Reclaimer::set_epoch_advance_step(1);
+        concurrent_ptr<Quux> root(new Quux());
+        std::atomic<int> step(0);
+        std::thread reader([&]() {
+            auto guard = reclamation::acquire_guard(root);
+            step = 1;
+            while (step != 2)
+                std::this_thread::yield();
+        });
+        while (step != 1)
+            std::this_thread::yield();
+
+        {
+            concurrent_ptr<Quux>::guard_ptr guard(new Quux());
+            guard.reclaim();
+        }
+        for (int i = 0; i < 1000; ++i)
+            update_epoch();
+        assert(Quux::instances == 2);
+
+        step = 2;
+        reader.join();
+        for (int i = 0; i < 1000 && Quux::instances != 1; ++i)
+            update_epoch();
+        assert(Quux::instances == 1);
+
+        Reclaimer::set_epoch_advance_step(0);
+        {
+            auto guard = reclamation::acquire_guard(root);
+            root.store(nullptr);
+            guard.reclaim();
+        }
+        wrap_around_epochs();
+        assert(Quux::instances == 0);
+    }
+
+#ifdef EPOCH_BASED_MONOTONIC_EPOCHS
+    // with monotonic epochs, objects are reclaimed two epochs after they were retired if no
+    // thread lags behind, and orphans are merged by their retire epoch
+    void test27() {
+        {
+            concurrent_ptr<Quux>::guard_ptr guard(new Quux());
+            guard.reclaim();
+        }
+        update_epoch();
+        assert(Quux::instances == 1);
+        update_epoch();
+#ifdef EPOCH_BASED_ASYMMETRIC_FENCE
+        // announcements are not scanned for the horizon, so it takes one more epoch
+        update_epoch();
+#endif
+        assert(Quux::instances == 0);
+
+        std::thread([]() {
+            concurrent_ptr<Quux>::guard_ptr guard(new Quux());
+            guard.reclaim();
+        }).join();
+        assert(Quux::instances == 1);
+        update_epoch();
+        update_epoch();
+        update_epoch();
+        assert(Quux::instances == 0);
+    }
+#endif
+
+    // the statistics count retirement, reclamation and epoch advances, and identify the thread
+    // that blocks an advance
+    void test28() {
+        const auto before = Reclaimer::snapshot();
+        {
+            concurrent_ptr<Quux>::guard_ptr guard(new Quux());
+            guard.reclaim();
+        }
+        wrap_around_epochs();
+        auto after = Reclaimer::snapshot();
+        assert(after.total.retired_objects == before.total.retired_objects + 1);
+        assert(after.total.retired_bytes == before.total.retired_bytes + sizeof(Quux));
+        assert(after.total.reclaimed_objects == before.total.reclaimed_objects + 1);
+        assert(after.total.epoch_advances >= before.total.epoch_advances + 3);
+
+        concurrent_ptr<Quux> root(new Quux());
+        std::atomic<int> step(0);
+        std::atomic<std::uint32_t> reader_slot(Reclaimer::no_thread);
+        std::thread reader([&]() {
+            auto guard = reclamation::acquire_guard(root);
+            for (auto& t : Reclaimer::snapshot().threads)
+                if (t.registered && t.in_critical_region)
+                    reader_slot = t.thread;
+            step = 1;
+            while (step != 2)
+                std::this_thread::yield();
+        });
+        while (step != 1)
+            std::this_thread::yield();
+
+        wrap_around_epochs();
+        after = Reclaimer::snapshot();
+        assert(after.total.failed_advances > before.total.failed_advances);
+        auto blocker = std::find_if(after.threads.begin(), after.threads.end(),
+            [&](auto& t) { return t.thread == reader_slot; });
+        assert(blocker != after.threads.end() && blocker->blocked_advances > 0);
+        assert(std::any_of(after.threads.begin(), after.threads.end(),
+            [&](auto& t) { return t.last_blocker == reader_slot; }));
+
+        step = 2;
+        reader.join();
+        auto guard = reclamation::acquire_guard(root);
+        root.store(nullptr);
+        guard.reclaim();
+    }
+
+    // a reader that stays in the previous epoch is reported with its label and how long it has been
+    // in its critical region, and the stall handler fires whenever it blocked another 4 updates
+    void test29() {
+        static std::atomic<int> reports(0);
+        Reclaimer::set_stall_detection(true);
+        Reclaimer::set_stall_handler([](const Reclaimer::stalled_thread& t) {
+            if (t.label == "slow reader")
+                ++reports;
+        }, 4);
+
+        concurrent_ptr<Quux> root(new Quux());
+        std::atomic<int> step(0);
+        std::thread reader([&]() {
+            Reclaimer::set_thread_label("slow reader");
+            auto guard = reclamation::acquire_guard(root);
+            step = 1;
+            while (step != 2)
+                std::this_thread::yield();
+        });
+        while (step != 1)
+            std::this_thread::yield();
+
+        update_epoch();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        auto stalled = Reclaimer::stalled_threads(std::chrono::milliseconds(1));
+        assert(stalled.size() == 1 && stalled[0].label == "slow reader");
+        assert(stalled[0].in_critical_region >= std::chrono::milliseconds(1));
+        assert(Reclaimer::stalled_threads(std::chrono::hours(1)).empty());
+
+        for (int i = 0; i < 8; ++i)
+            update_epoch();
+        assert(reports == 2);
+
+        step = 2;
+        reader.join();
+        assert(Reclaimer::stalled_threads().empty());
+        Reclaimer::set_stall_handler(nullptr);
+        Reclaimer::set_stall_detection(false);
+
+        auto guard = reclamation::acquire_guard(root);
+        root.store(nullptr);
+        guard.reclaim();
+    }
+
+#ifdef EPOCH_BASED_TRACING
+    // reclaimed objects show up in the age histogram, and advances, blocked advances and
+    // reclamations in the trace of the respective thread
+    void test30() {
+        const auto before = Reclaimer::retire_ages().total;
+        for (int i = 0; i < 10; ++i)
+        {
+            concurrent_ptr<Quux>::guard_ptr guard(new Quux());
+            guard.reclaim();
+        }
+        wrap_around_epochs();
+        assert(Quux::instances == 0);
+        auto ages = Reclaimer::retire_ages();
+        assert(ages.total == before + 10);
+        assert(ages.percentile(50) <= ages.percentile(99) && ages.percentile(99) <= ages.max);
+
+        concurrent_ptr<Quux> root(new Quux());
+        std::atomic<int> step(0);
+        std::thread reader([&]() {
+            Reclaimer::set_thread_label("traced \"reader\"");
+            auto guard = reclamation::acquire_guard(root);
+            step = 1;
+            while (step != 2)
+                std::this_thread::yield();
+        });
+        while (step != 1)
+            std::this_thread::yield();
+        update_epoch();
+        update_epoch();
+
+        std::ostringstream out;
+        Reclaimer::write_chrome_trace(out);
+        step = 2;
+        reader.join();
+        const auto trace = out.str();
+        assert(trace.find("{\"displayTimeUnit\": \"ns\", \"traceEvents\": [") == 0);
+        assert(trace.find("\"name\": \"epoch advance\"") != std::string::npos);
+        assert(trace.find("\"name\": \"failed advance\"") != std::string::npos);
+        assert(trace.find("\"name\": \"reclamation\", \"cat\": \"reclamation\"") != std::string::npos);
+        assert(trace.find("\"args\": {\"name\": \"traced \\\"reader\\\"\"}") != std::string::npos);
+        assert(trace.compare(trace.size() - 4, 4, "\n]}\n") == 0);
+
+        auto guard = reclamation::acquire_guard(root);
+        root.store(nullptr);
+        guard.reclaim();
+    }
+#endif
+
+    // synchronize waits for readers that were active at the time of the call, and flush
+    // reclaims everything retired so far, including orphans
+    void test31() {
+        for (int i = 0; i < 10; ++i)
+        {
+            concurrent_ptr<Quux>::guard_ptr guard(new Quux());
+            guard.reclaim();
+        }
+        std::thread([]() {
+            concurrent_ptr<Quux>::guard_ptr guard(new Quux());
+            guard.reclaim();
+        }).join();
+        Reclaimer::flush();
+        assert(Quux::instances == 0);
+        assert(Reclaimer::pending_retired().first == 0);
+
+        concurrent_ptr<Quux> root(new Quux());
+        std::atomic<int> step(0);
+        std::thread reader([&]() {
+            auto guard = reclamation::acquire_guard(root);
+            step = 1;
+            while (step != 2)
+                std::this_thread::yield();
+        });
+        while (step != 1)
+            std::this_thread::yield();
+
+        std::atomic<bool> synchronized(false);
+        std::thread updater([&]() {
+            Reclaimer::synchronize();
+            synchronized = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        assert(!synchronized);
+        step = 2;
+        reader.join();
+        updater.join();
+        assert(synchronized);
+
+        {
+            auto guard = reclamation::acquire_guard(root);
+            root.store(nullptr);
+            guard.reclaim();
+        }
+        Reclaimer::flush();
+        assert(Quux::instances == 0);
+    }
+
+    // deferred callbacks run once their epoch has expired, also when deferred by a terminated
+    // thread, and destroy what they captured
+    void test32() {
+        static std::vector<int> order;
+        auto buffer = std::make_shared<int>(42);
+        for (int i = 0; i < 100; ++i)
+            Reclaimer::defer([i, buffer]() { order.push_back(i); });
+        std::thread([]() {
+            Reclaimer::defer([]() { order.push_back(100); });
+        }).join();
+        Reclaimer::flush();
+        std::sort(order.begin(), order.end());
+        for (int i = 0; i <= 100; ++i)
+            assert(order.size() == 101 && order[i] == i);
+        assert(buffer.use_count() == 1);
+
+        std::atomic<int> step(0);
+        std::thread reader([&]() {
+            Reclaimer::region_guard region;
+            step = 1;
+            while (step != 2)
+                std::this_thread::yield();
+        });
+        while (step != 1)
+            std::this_thread::yield();
+
+        bool called = false;
+        Reclaimer::defer([&called]() { called = true; });
+        for (int i = 0; i < 10; ++i)
+            update_epoch();
+        assert(!called);
+        step = 2;
+        reader.join();
+        wrap_around_epochs();
+        assert(called);
+    }
+
+    // a reader in one domain blocks only that domain's epoch
+    void test33() {
+        ColdReclaimer::concurrent_ptr<Cold> cold(new Cold());
+        std::atomic<int> step(0);
+        std::thread reader([&]() {
+            auto guard = reclamation::acquire_guard(cold);
+            step = 1;
+            while (step != 2)
+                std::this_thread::yield();
+        });
+        while (step != 1)
+            std::this_thread::yield();
+
+        {
+            concurrent_ptr<Quux>::guard_ptr guard(new Quux());
+            guard.reclaim();
+        }
+        wrap_around_epochs();
+        assert(Quux::instances == 0);
+
+        {
+            ColdReclaimer::concurrent_ptr<Cold>::guard_ptr guard(new Cold());
+            guard.reclaim();
+        }
+        for (int i = 0; i < 10; ++i)
+            ColdReclaimer::concurrent_ptr<Cold>::guard_ptr guard(cold.load());
+        assert(Cold::instances == 2);
+
+        step = 2;
+        reader.join();
+        {
+            auto guard = reclamation::acquire_guard(cold);
+            cold.store(nullptr);
+            guard.reclaim();
+        }
+        ColdReclaimer::flush();
+        assert(Cold::instances == 0);
+    }
+
+    // guards and region guards work the same with an explicit thread context
+    void test34() {
+        auto context = Reclaimer::get_thread_context();
+        concurrent_ptr<Quux> root(new Quux());
+        {
+            Reclaimer::region_guard region(context);
+            concurrent_ptr<Quux>::guard_ptr guard(context);
+            guard.acquire(root);
+            assert(guard.get() != nullptr);
+            concurrent_ptr<Quux>::guard_ptr copy(guard);
+            concurrent_ptr<Quux>::guard_ptr moved(std::move(guard));
+            assert(copy.get() == moved.get() && guard.get() == nullptr);
+            assert(copy.get_context() == context && moved.get_context() == context);
+        }
+        {
+            // Copies and moves keep the original's context instead of looking up their own. A
+            // context of another thread makes that observable; the thread is parked meanwhile.
+            std::atomic<int> step(0);
+            std::unique_ptr<Reclaimer::thread_context> other;
+            std::thread parked([&]() {
+                other.reset(new Reclaimer::thread_context(Reclaimer::get_thread_context()));
+                step = 1;
+                while (step != 2)
+                    std::this_thread::yield();
+            });
+            while (step != 1)
+                std::this_thread::yield();
+            {
+                concurrent_ptr<Quux>::guard_ptr guard(*other);
+                guard.acquire(root);
+                concurrent_ptr<Quux>::guard_ptr copy(guard);
+                concurrent_ptr<Quux>::guard_ptr moved(std::move(guard));
+                assert(*other != context);
+                assert(copy.get_context() == *other && moved.get_context() == *other);
+            }
+            step = 2;
+            parked.join();
+        }
+        {
+            concurrent_ptr<Quux>::guard_ptr guard(context);
+            guard.acquire(root);
+            root.store(nullptr);
+            guard.reclaim();
+        }
+        for (int i = 0; i < 3; ++i)
+            concurrent_ptr<Foo>::guard_ptr guard(context, foo);
+        assert(Quux::instances == 0);
+    }
+
+    // a QSBR thread that reads under nothing but a region_guard still blocks reclamation, so
+    // the skip list's lookups and scans are safe on threads that never create a guard_ptr
+    void test35() {
+        QSBR::concurrent_ptr<Qux> root(new Qux());
+        std::atomic<int> step(0);
+        std::thread reader([&]() {
+            {
+                QSBR::region_guard region;
+                step = 1;
+                while (step != 2)
+                    std::this_thread::yield();
+            }
+            while (step != 3)
+            {
+                QSBR::quiescent_state();
+                std::this_thread::yield();
+            }
+        });
+        while (step != 1)
+            std::this_thread::yield();
+
+        {
+            QSBR::region_guard region;
+            auto guard = reclamation::acquire_guard(root);
+            root.store(nullptr);
+            guard.reclaim();
+        }
+        for (int i = 0; i < 10; ++i)
+            QSBR::quiescent_state();
+        assert(Qux::instances == 1);
+
+        step = 2;
+        for (int i = 0; i < 100000 && Qux::instances != 0; ++i)
+        {
+            QSBR::quiescent_state();
+            std::this_thread::yield();
+        }
+        assert(Qux::instances == 0);
+        step = 3;
+        reader.join();
+
+        constexpr int keys = 1000, rounds = 20;
+        reclamation::skip_list_map<int, int, QSBR> map;
+        for (int k = 0; k < keys; k += 2)
+            assert(map.insert(k, -k));
+
+        std::atomic<bool> done(false);
+        std::thread writer([&map, &done]() {
+            for (int r = 0; r < rounds; ++r)
+            {
+                for (int k = 1; k < keys; k += 2)
+                    assert(map.insert(k, -k));
+                for (int k = 1; k < keys; k += 2)
+                    assert(map.erase(k));
+                QSBR::quiescent_state();
+            }
+            done = true;
+        });
+        std::thread([&]() {
+            while (!done.load())
+            {
+                for (int k = 0; k < keys; k += 2)
+                {
+                    int v;
+                    assert(map.find(k, v) && v == -k);
+                    assert(map.contains(k));
+                }
+                int count = 0;
+                for (auto& entry : map.scan(0, keys))
+                    count += entry.first % 2 == 0;
+                assert(count == keys / 2);
+                QSBR::quiescent_state();
+            }
+        }).join();
+        writer.join();
+        for (int i = 0; i < 10; ++i)
+            QSBR::quiescent_state();
+    }
+
+    // threads racing to insert the same string keys insert each key exactly once and at its
+    // place in the order, so every key is found and erased exactly once afterwards
+    void test36() {
+        constexpr int threads_count = 4, keys = 1000;
+        reclamation::harris_michael_list_based_set<std::string, Reclaimer> set;
+        std::atomic<int> inserted(0);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threads_count; ++t)
+            threads.emplace_back([&, t]() {
+                for (int i = 0; i < keys; ++i)
+                    inserted += set.insert(string_key((i * 7 + t * 13) % keys));
+            });
+        for (auto& t : threads)
+            t.join();
+
+        assert(inserted == keys);
+        for (int k = 0; k < keys; ++k)
+            assert(set.contains(string_key(k)));
+        for (int k = 0; k < keys; ++k)
+            assert(set.erase(string_key(k)));
+        for (int k = 0; k < keys; ++k)
+            assert(!set.erase(string_key(k)));
+    }
+
+    // the same for the hash map, which also grows while the threads race
+    void test37() {
+        constexpr int threads_count = 4, keys = 4000;
+        reclamation::split_ordered_hash_map<std::string, int, Reclaimer> map(2);
+        std::atomic<int> inserted(0);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threads_count; ++t)
+            threads.emplace_back([&, t]() {
+                for (int i = 0; i < keys; ++i)
+                {
+                    const int k = (i * 7 + t * 13) % keys;
+                    inserted += map.insert(string_key(k), k);
+                }
+            });
+        for (auto& t : threads)
+            t.join();
+
+        assert(inserted == keys);
+        assert(map.size() == keys);
+        for (int k = 0; k < keys; ++k)
+        {
+            int value = -1;
+            assert(map.find(string_key(k), value) && value == k);
+        }
+        for (int k = 0; k < keys; ++k)
+            assert(map.erase(string_key(k)));
+        for (int k = 0; k < keys; ++k)
+            assert(!map.erase(string_key(k)));
+    }
+
+    // the same for the skip list, whose scans also show that the keys stay sorted and unique
+    void test38() {
+        constexpr int threads_count = 4, keys = 4000;
+        reclamation::skip_list_map<std::string, int, Reclaimer> map;
+        std::atomic<int> inserted(0);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threads_count; ++t)
+            threads.emplace_back([&, t]() {
+                for (int i = 0; i < keys; ++i)
+                {
+                    const int k = (i * 7 + t * 13) % keys;
+                    inserted += map.insert(string_key(k), k);
+                }
+            });
+        for (auto& t : threads)
+            t.join();
+
+        assert(inserted == keys);
+        int next = 0;
+        for (auto& entry : map.scan(string_key(0), string_key(keys)))
+        {
+            assert(entry.first == string_key(next) && entry.second == next);
+            ++next;
+        }
+        assert(next == keys);
+        for (int k = 0; k < keys; ++k)
+            assert(map.erase(string_key(k)));
+        for (int k = 0; k < keys; ++k)
+            assert(!map.contains(string_key(k)));
+    }
+
+    // an epoch update finds a blocking thread behind many threads that announced the same epoch
+    // but have left their critical regions since
+    void test39() {
+        constexpr int idle_count = 40;
+        std::atomic<int> step(0), idle(0);
+        // the pinner's region keeps the epoch from advancing past the one all others enter
+        std::thread pinner([&]() {
+            Reclaimer::region_guard rg;
+            step = 1;
+            while (step != 3)
+                std::this_thread::yield();
+        });
+        while (step != 1)
+            std::this_thread::yield();
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < idle_count; ++i)
+            threads.emplace_back([&]() {
+                {
+                    Reclaimer::region_guard rg;
+                }
+                ++idle;
+                while (step != 4)
+                    std::this_thread::yield();
+            });
+        while (idle != idle_count)
+            std::this_thread::yield();
+        threads.emplace_back([&]() {
+            Reclaimer::region_guard rg;
+            step = 2;
+            while (step != 4)
+                std::this_thread::yield();
+        });
+        while (step != 2)
+            std::this_thread::yield();
+        step = 3;
+        pinner.join();
+
+        {
+            concurrent_ptr<Foo>::guard_ptr gp(mp);
+            gp.reclaim();
+            this->mp = nullptr;
+        }
+        for (int i = 0; i < 10; ++i)
+            update_epoch();
+        assert(foo != nullptr);
+
+        step = 4;
+        for (auto& t : threads)
+            t.join();
+        wrap_around_epochs();
+        assert(foo == nullptr);
+    }
+
     ~EpochBasedTest() {
         wrap_around_epochs();
         if (mp == nullptr)
@@ -198,6 +1356,157 @@ int main(int argc, char const *argv[])
         EpochBasedTest a;
         a.test10();
     }
+
+    {
+        EpochBasedTest a;
+        a.test11();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test12();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test13();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test14();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test15();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test16();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test17();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test18();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test19();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test20();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test21();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test22();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test23();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test24();
+    }
+
+#ifdef EPOCH_BASED_HAZARD_FALLBACK
+    {
+        EpochBasedTest a;
+        a.test25();
+    }
+#endif
+
+    {
+        EpochBasedTest a;
+        a.test26();
+    }
+
+#ifdef EPOCH_BASED_MONOTONIC_EPOCHS
+    {
+        EpochBasedTest a;
+        a.test27();
+    }
+#endif
+
+    {
+        EpochBasedTest a;
+        a.test28();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test29();
+    }
+
+#ifdef EPOCH_BASED_TRACING
+    {
+        EpochBasedTest a;
+        a.test30();
+    }
+#endif
+
+    {
+        EpochBasedTest a;
+        a.test31();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test32();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test33();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test34();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test35();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test36();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test37();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test38();
+    }
+
+    {
+        EpochBasedTest a;
+        a.test39();
+    }
     
     return 0;
 }
\ No newline at end of file
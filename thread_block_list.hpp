@@ -1,12 +1,20 @@
 #ifndef _THREAD_BLOCK_LIST_
 #define _THREAD_BLOCK_LIST_
 
+#include <algorithm>
 #include <atomic>
+#include <cassert>
+#include <cstdint>
 #include <iterator>
+#include <thread>
+
+#include "find_word.hpp"
 
 namespace reclamation { namespace techniques { namespace utils {
 
-template <typename T, typename DeletableObject = utils::deletable_object>
+struct orphan;
+
+template <typename T, typename DeletableObject = utils::orphan>
 class thread_block_list
 {
     enum class entry_state {
@@ -38,6 +46,27 @@ public:
             state.store(entry_state::active, std::memory_order_release);
         }
 
+        // The entry's word in the list's announcement array. Its meaning is defined by T;
+        // the word of a newly created entry is 0.
+        std::atomic<std::uint32_t>& announcement() const { return *announcement_word; }
+
+        // Publishes the hint for the announcements that follow. Whenever the owner is about to
+        // announce a value that find_announcement may look for under a different hint, it has to
+        // publish that hint first. The hint of a newly created entry is 0. Hints change far less
+        // often than announcements, e.g., once per epoch instead of once per critical region, so
+        // unchanged hints are not stored again.
+        void publish_hint(std::uint32_t hint) {
+            if (hint == published_hint)
+                return;
+            published_hint = hint;
+            // (11) - this release-store synchronizes-with the acquire-fence that follows a relaxed
+            //        find_announcement, or with the acquire-load (12)
+            hint_word->store(hint, std::memory_order_release);
+        }
+
+        // Index of the entry's announcement word. Slots are never reassigned.
+        std::uint32_t slot() const { return slot_index; }
+
     private:
         friend class thread_block_list;
 
@@ -57,6 +86,14 @@ public:
         // next_entry is only set once when it gets inserted into the list and is never changed afterwards
         // -> therefore it does not have to be atomic
         T* next_entry;
+
+        // set once before the entry gets inserted into the list
+        std::atomic<std::uint32_t>* announcement_word = nullptr;
+        std::atomic<std::uint32_t>* hint_word = nullptr;
+        std::uint32_t slot_index = 0;
+
+        // only accessed by the owner; handed over with the entry's state
+        std::uint32_t published_hint = 0;
     };
 
     class iterator : public std::iterator<std::forward_iterator_tag, T> {
@@ -149,6 +186,51 @@ public:
                 std::memory_order_release, std::memory_order_relaxed));
     }
 
+    // Returns an entry whose announcement word is equal to value and whose published hint is
+    // equal to hint, or nullptr if there is none. Only the slots handed out so far are scanned.
+    // Instead of following next_entry, the dense hint arrays are swept with find_word, and only
+    // the announcement words of matching hints are loaded; free entries are not skipped but
+    // their announcements never match one of an active thread.
+    T* find_announcement(std::uint32_t hint, std::uint32_t value, std::memory_order order = std::memory_order_relaxed) {
+        // (8) - this acquire-load synchronizes-with the release-CAS (9)
+        const auto used = used_slots.load(std::memory_order_acquire);
+        for (std::uint32_t first = 0; first < used; first += slots_per_segment)
+        {
+            auto seg = segments[first / slots_per_segment].load(std::memory_order_acquire);
+            if (seg == nullptr)
+                continue;
+
+            const std::size_t n = std::min<std::size_t>(slots_per_segment, used - first);
+            // (12) - in TSan builds, find_word performs acquire-loads that synchronize-with the
+            //        release-store (11)
+            for (std::size_t idx = utils::find_word(seg->hints, n, hint, order); idx != n;
+                 idx += 1 + utils::find_word(seg->hints + idx + 1, n - idx - 1, hint, order))
+            {
+                if (seg->words[idx * words_per_line].load(order) == value)
+                    return seg->entries[idx].load(std::memory_order_acquire);
+            }
+        }
+        return nullptr;
+    }
+
+    // Returns an entry whose announcement word and published hint are equal to value.
+    T* find_announcement(std::uint32_t value, std::memory_order order = std::memory_order_relaxed) {
+        return find_announcement(value, value, order);
+    }
+
+    // Number of announcement slots handed out so far; slots are numbered from 0.
+    std::uint32_t slot_count() const {
+        // (10) - this acquire-load synchronizes-with the release-CAS (9)
+        return used_slots.load(std::memory_order_acquire);
+    }
+
+    // Returns the announcement word of the given slot, or nullptr if its segment does not exist yet.
+    const std::atomic<std::uint32_t>* announcement_at(std::uint32_t slot) const {
+        assert(slot < max_slots);
+        auto seg = segments[slot / slots_per_segment].load(std::memory_order_acquire);
+        return seg != nullptr ? &seg->words[(slot % slots_per_segment) * words_per_line] : nullptr;
+    }
+
     DeletableObject* adopt_abandoned_retired_nodes() {
         if (abandoned_retired_nodes.load(std::memory_order_relaxed) == nullptr)
             return nullptr;
@@ -169,24 +251,84 @@ private:
     T* adopt_or_create_entry(entry_state initial_state) {
         static_assert(std::is_base_of<entry, T>::value, "T must derive from entry.");
 
-        // (7) - this acquire-load synchronizes-with the release-CAS (6)
-        T* result = head.load(std::memory_order_acquire);
-        while (result)
+        for (;;)
         {
-            if (result->try_adopt(initial_state))
+            // (7) - this acquire-load synchronizes-with the release-CAS (6)
+            T* result = head.load(std::memory_order_acquire);
+            while (result)
+            {
+                if (result->try_adopt(initial_state))
+                    return result;
+
+                result = result->next_entry;
+            }
+
+            auto slot = next_slot.load(std::memory_order_relaxed);
+            while (slot < max_slots && !next_slot.compare_exchange_weak(slot, slot + 1, std::memory_order_relaxed))
+                ;
+            if (slot < max_slots)
+            {
+                result = new T();
+                result->state.store(initial_state, std::memory_order_relaxed);
+                assign_slot(result, slot);
+                add_entry(result);
                 return result;
+            }
+
+            // All slots are taken, so we have to wait until some thread releases its entry.
+            std::this_thread::yield();
+        }
+    }
 
-            result = result->next_entry;
+    void assign_slot(T* entry, std::uint32_t slot) {
+        auto& seg_ptr = segments[slot / slots_per_segment];
+        auto seg = seg_ptr.load(std::memory_order_acquire);
+        if (seg == nullptr)
+        {
+            auto new_seg = new segment();
+            if (seg_ptr.compare_exchange_strong(seg, new_seg, std::memory_order_acq_rel, std::memory_order_acquire))
+                seg = new_seg;
+            else
+                delete new_seg;
         }
 
-        result = new T();
-        result->state.store(initial_state, std::memory_order_relaxed);
-        add_entry(result);
-        return result;
+        const auto idx = slot % slots_per_segment;
+        seg->entries[idx].store(entry, std::memory_order_relaxed);
+        entry->announcement_word = &seg->words[idx * words_per_line];
+        entry->hint_word = &seg->hints[idx];
+        entry->slot_index = slot;
+
+        // raise the high-water mark so scans include the new slot
+        auto used = used_slots.load(std::memory_order_relaxed);
+        // (9) - this release-CAS synchronizes-with the acquire-loads (8, 10)
+        while (used < slot + 1 && !used_slots.compare_exchange_weak(used, slot + 1,
+                std::memory_order_release, std::memory_order_relaxed))
+            ;
     }
 
+    static constexpr std::uint32_t slots_per_segment = 256;
+    static constexpr std::uint32_t max_segments = 256;
+    static constexpr std::uint32_t max_slots = slots_per_segment * max_segments;
+    // every announcement word occupies a cache line of its own
+    static constexpr std::size_t words_per_line = 64 / sizeof(std::uint32_t);
+
+    // Announcements and hints are kept in slot-indexed segments. Each announcement word sits on its
+    // own cache line, so entering and leaving a critical region never false-shares with other
+    // threads. The hints are packed densely instead, so that find_announcement can sweep them with
+    // vector instructions; they are only written when they change. Segments are allocated on
+    // demand and never freed.
+    struct segment {
+        alignas(64) std::atomic<std::uint32_t> hints[slots_per_segment] = {};
+        alignas(64) std::atomic<std::uint32_t> words[slots_per_segment * words_per_line] = {};
+        std::atomic<T*> entries[slots_per_segment] = {};
+    };
+
     std::atomic<T*> head;
 
+    std::atomic<segment*> segments[max_segments];
+    std::atomic<std::uint32_t> next_slot;
+    std::atomic<std::uint32_t> used_slots;
+
     alignas(64) std::atomic<DeletableObject*> abandoned_retired_nodes;
 };
 
@@ -0,0 +1,227 @@
+#ifndef _TRACE_
+#define _TRACE_
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace reclamation { namespace techniques { namespace utils {
+
+inline std::int64_t trace_clock() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Log-linear histogram of durations in nanoseconds: 8 linear sub-buckets per power of two.
+struct age_histogram {
+    static constexpr unsigned sub_buckets = 8;
+    static constexpr unsigned buckets = 64 * sub_buckets;
+
+    void record(std::uint64_t ns, std::uint64_t count = 1) {
+        counts[index(ns)] += count;
+        total += count;
+        max = std::max(max, ns);
+    }
+
+    void merge(const age_histogram& other) {
+        for (unsigned i = 0; i < buckets; ++i)
+            counts[i] += other.counts[i];
+        total += other.total;
+        max = std::max(max, other.max);
+    }
+
+    // Upper bound of the bucket containing the given percentile.
+    std::uint64_t percentile(double p) const {
+        if (total == 0)
+            return 0;
+        auto rank = static_cast<std::uint64_t>(p / 100.0 * (total - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (unsigned i = 0; i < buckets; ++i)
+        {
+            seen += counts[i];
+            if (seen >= rank)
+                return std::min(upper_bound(i), max);
+        }
+        return max;
+    }
+
+    std::array<std::uint64_t, buckets> counts = {};
+    std::uint64_t total = 0;
+    std::uint64_t max = 0;
+
+private:
+    static unsigned index(std::uint64_t v) {
+        if (v < sub_buckets)
+            return static_cast<unsigned>(v);
+        unsigned log = 63 - __builtin_clzll(v);
+        unsigned shift = log - 3;
+        return (shift + 1) * sub_buckets + static_cast<unsigned>((v >> shift) & (sub_buckets - 1));
+    }
+
+    static std::uint64_t upper_bound(unsigned i) {
+        if (i < sub_buckets)
+            return i;
+        unsigned shift = i / sub_buckets - 1;
+        return ((std::uint64_t(sub_buckets + i % sub_buckets) + 1) << shift) - 1;
+    }
+};
+
+enum class trace_event_kind : std::uint8_t {
+    epoch_advance,
+    failed_advance,
+    orphan_adoption,
+    reclamation,
+    handover
+};
+
+struct trace_event {
+    std::int64_t start;     // trace_clock() time
+    std::int64_t duration;  // 0 for instant events
+    trace_event_kind kind;
+    std::uint64_t epoch;
+    // reclaimed, adopted or handed over objects; for failed advances the blocking thread's slot
+    std::uint64_t value;
+};
+
+// The most recent trace events of a single thread in a ring buffer, and the ages of the objects it
+// reclaimed. Only the owning thread records, but dumps may read concurrently; events are rare
+// compared to critical region entries, so a practically uncontended mutex keeps this simple.
+class trace_buffer {
+public:
+    static constexpr std::size_t capacity = 4096;
+
+    void record(const trace_event& event) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (events.size() < capacity)
+            events.push_back(event);
+        else
+            events[next] = event;
+        next = (next + 1) % capacity;
+    }
+
+    void record_age(std::int64_t retired_at, std::int64_t now, std::size_t count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ages.record(static_cast<std::uint64_t>(std::max<std::int64_t>(now - retired_at, 0)), count);
+    }
+
+    // Returns the recorded events, oldest first.
+    std::vector<trace_event> get_events() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (events.size() < capacity)
+            return events;
+        std::vector<trace_event> result(events.begin() + next, events.end());
+        result.insert(result.end(), events.begin(), events.begin() + next);
+        return result;
+    }
+
+    age_histogram get_ages() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return ages;
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::vector<trace_event> events;
+    std::size_t next = 0;
+    age_histogram ages;
+};
+
+// Records the ages of objects that are reclaimed one by one; consecutive objects retired at the
+// same time (i.e., from the same chunk) are recorded at once.
+class age_run {
+public:
+    explicit age_run(trace_buffer& buffer) : buffer(buffer) {}
+    age_run(const age_run&) = delete;
+    age_run& operator=(const age_run&) = delete;
+    ~age_run() { flush(); }
+
+    void add(std::int64_t retired_at) {
+        if (count != 0 && retired_at != stamp)
+            flush();
+        stamp = retired_at;
+        ++count;
+    }
+
+    void flush() {
+        if (count != 0)
+            buffer.record_age(stamp, trace_clock(), count);
+        count = 0;
+    }
+
+private:
+    trace_buffer& buffer;
+    std::int64_t stamp = 0;
+    std::size_t count = 0;
+};
+
+inline const char* trace_event_name(trace_event_kind kind) {
+    switch (kind)
+    {
+        case trace_event_kind::epoch_advance: return "epoch advance";
+        case trace_event_kind::failed_advance: return "failed advance";
+        case trace_event_kind::orphan_adoption: return "orphan adoption";
+        case trace_event_kind::reclamation: return "reclamation";
+        case trace_event_kind::handover: return "handover";
+    }
+    return "unknown";
+}
+
+inline void write_json_string(std::ostream& out, const std::string& s) {
+    out << '"';
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20)
+            out << ' ';
+        else
+            out << c;
+    }
+    out << '"';
+}
+
+// Writes the events of one thread as entries of a Chrome trace "traceEvents" array; first is
+// updated to tell whether a separating comma is needed.
+inline void write_chrome_trace_events(std::ostream& out, std::uint32_t tid, const std::string& label,
+                                      const std::vector<trace_event>& events, bool& first) {
+    auto separator = [&]() {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    if (!label.empty())
+    {
+        separator();
+        out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << tid << ", \"args\": {\"name\": ";
+        write_json_string(out, label);
+        out << "}}";
+    }
+
+    for (auto& e : events)
+    {
+        separator();
+        // timestamps and durations are in microseconds
+        out << "{\"name\": \"" << trace_event_name(e.kind) << "\", \"cat\": \"reclamation\", \"pid\": 1, \"tid\": " << tid
+            << ", \"ts\": " << e.start / 1000 << '.' << (e.start % 1000) / 100;
+        if (e.kind == trace_event_kind::reclamation)
+            out << ", \"ph\": \"X\", \"dur\": " << e.duration / 1000 << '.' << (e.duration % 1000) / 100;
+        else
+            out << ", \"ph\": \"i\", \"s\": \"t\"";
+        out << ", \"args\": {\"epoch\": " << e.epoch;
+        if (e.kind == trace_event_kind::failed_advance)
+            out << ", \"blocking_thread\": " << e.value;
+        else if (e.kind != trace_event_kind::epoch_advance)
+            out << ", \"objects\": " << e.value;
+        out << "}}";
+    }
+}
+
+}}}
+
+#endif